@@ -0,0 +1,745 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * B+-tree map with the upsert / get / remove / iterator surface of RBTree,
+ * meant for large read-mostly indexes. Nodes hold up to NodeKeys sorted keys
+ * (two cache lines of int64_t keys by default), so a lookup takes one cache
+ * miss per level of a tree about 7 levels deep at 10M keys, instead of one
+ * per level of a ~25 levels deep binary tree. Entries live in the leaves,
+ * which are linked both ways for iteration. On int64_t keys ordered by
+ * std::less, the in-node search is a branchless SIMD count of the keys
+ * smaller than the probe.
+ *
+ * An inner key is an upper bound of the child on its left and smaller than
+ * every key of the child on its right, so the child to descend into is the
+ * number of inner keys smaller than the probe. Key and Value must be default
+ * constructible.
+ */
+template <class Key, class Value, class Compare = std::less<Key>,
+          int NodeKeys = 16>
+class BPlusTree {
+  static_assert(NodeKeys >= 4 && NodeKeys % 4 == 0);
+  // every node but the root holds at least this many keys
+  static constexpr int32_t MIN_KEYS = NodeKeys / 2;
+  // enough for any tree that fits in memory at the minimum fanout
+  static constexpr int32_t MAX_HEIGHT = 64;
+  static constexpr bool SIMD_KEYS =
+      std::is_same_v<Key, int64_t> &&
+      (std::is_same_v<Compare, std::less<int64_t>> ||
+       std::is_same_v<Compare, std::less<>>);
+
+  // keys first, so that the SIMD search loads aligned cache lines
+  struct alignas(64) Leaf {
+    Leaf() : count(0), prev(nullptr), next(nullptr) { pad(keys, 0); }
+
+    Key keys[NodeKeys];
+    int32_t count;
+    Leaf* prev;
+    Leaf* next;
+    Value values[NodeKeys];
+  };
+
+  struct alignas(64) Inner {
+    Inner() : count(0) { pad(keys, 0); }
+
+    Key keys[NodeKeys];
+    // number of keys, the node has count + 1 children
+    int32_t count;
+    // Inner* above the last inner level, Leaf* on it
+    void* children[NodeKeys + 1];
+  };
+
+  template <bool Const>
+  class BPlusTreeIterator {
+    friend class BPlusTree;
+
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::pair<const Key, Value>;
+    using difference_type = std::ptrdiff_t;
+    using reference =
+        std::pair<const Key&, std::conditional_t<Const, const Value&, Value&>>;
+    struct pointer {
+      reference ref;
+      reference* operator->() { return &ref; }
+    };
+
+    BPlusTreeIterator() : leaf_(nullptr), index_(0), tree_(nullptr) {}
+    // a mutable iterator converts to a const one
+    template <bool OtherConst, class = std::enable_if_t<Const && !OtherConst>>
+    BPlusTreeIterator(const BPlusTreeIterator<OtherConst>& other)
+        : leaf_(other.leaf_), index_(other.index_), tree_(other.tree_) {}
+
+    bool operator==(const BPlusTreeIterator& other) const {
+      return leaf_ == other.leaf_ && index_ == other.index_;
+    }
+
+    pointer operator->() const { return pointer{**this}; }
+    reference operator*() const {
+      return {leaf_->keys[index_], leaf_->values[index_]};
+    }
+
+    BPlusTreeIterator& operator++() {
+      if (++index_ == leaf_->count) {
+        leaf_ = leaf_->next;
+        index_ = 0;
+      }
+      return *this;
+    }
+    BPlusTreeIterator operator++(int) {
+      BPlusTreeIterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    BPlusTreeIterator& operator--() {
+      if (leaf_ == nullptr) {
+        leaf_ = tree_->lastLeaf();
+        index_ = leaf_->count - 1;
+      } else if (index_ > 0) {
+        index_--;
+      } else {
+        leaf_ = leaf_->prev;
+        index_ = leaf_->count - 1;
+      }
+      return *this;
+    }
+    BPlusTreeIterator operator--(int) {
+      BPlusTreeIterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+
+   private:
+    BPlusTreeIterator(Leaf* leaf, int32_t index, const BPlusTree* tree)
+        : leaf_(leaf), index_(index), tree_(tree) {}
+
+   private:
+    Leaf* leaf_;
+    int32_t index_;
+    // for decrementing end()
+    const BPlusTree* tree_;
+  };
+
+ public:
+  using iterator = BPlusTreeIterator<false>;
+  using const_iterator = BPlusTreeIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  static constexpr size_t LEAF_SIZE = sizeof(Leaf);
+  static constexpr size_t INNER_SIZE = sizeof(Inner);
+
+ public:
+  explicit BPlusTree(const Compare& compareFunc = Compare())
+      : compareFunc_(compareFunc),
+        head_(new Leaf()),
+        root_(head_),
+        height_(0),
+        size_(0) {}
+  ~BPlusTree() { destroy(root_, height_); }
+
+  BPlusTree(const BPlusTree&) = delete;
+  BPlusTree& operator=(const BPlusTree&) = delete;
+
+  inline size_t size() const { return size_; }
+
+  inline bool empty() const { return size_ == 0; }
+
+  // number of inner levels above the leaves
+  inline int32_t height() const { return height_; }
+
+  iterator begin() { return iterator(firstEntry(), 0, this); }
+  iterator end() { return iterator(nullptr, 0, this); }
+  const_iterator begin() const { return const_iterator(firstEntry(), 0, this); }
+  const_iterator end() const { return const_iterator(nullptr, 0, this); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  /**
+   * @brief Insert {key, value} if key doesn't exist, update the value else
+   *
+   * @param[in] key
+   * @param[in] value
+   */
+  void upsert(const Key& key, const Value& value) {
+    Inner* path[MAX_HEIGHT];
+    int32_t slots[MAX_HEIGHT];
+    Leaf* leaf = descend(key, path, slots);
+    const int32_t pos = search(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && !compareFunc_(key, leaf->keys[pos])) {
+      leaf->values[pos] = value;
+      return;
+    }
+
+    ++size_;
+    if (leaf->count < NodeKeys) {
+      insertEntry(leaf, pos, key, value);
+      return;
+    }
+
+    // move the upper half to a new leaf, then insert into the right half
+    Leaf* right = new Leaf();
+    right->count = NodeKeys - MIN_KEYS;
+    std::move(leaf->keys + MIN_KEYS, leaf->keys + NodeKeys, right->keys);
+    std::move(leaf->values + MIN_KEYS, leaf->values + NodeKeys,
+              right->values);
+    leaf->count = MIN_KEYS;
+    pad(leaf->keys, MIN_KEYS);
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) {
+      leaf->next->prev = right;
+    }
+    leaf->next = right;
+    if (pos <= MIN_KEYS) {
+      insertEntry(leaf, pos, key, value);
+    } else {
+      insertEntry(right, pos - MIN_KEYS, key, value);
+    }
+    insertIntoParents(path, slots, leaf->keys[leaf->count - 1], right);
+  }
+
+  /**
+   * @brief Get the value by specified key, return defaultValue if the key
+   * doesn't exist
+   *
+   * @param[in] key
+   * @param[in] defaultValue
+   * @return const Value&
+   */
+  const Value& get(const Key& key, const Value& defaultValue) const {
+    const Leaf* leaf = findLeaf(key);
+    const int32_t pos = search(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && !compareFunc_(key, leaf->keys[pos])) {
+      return leaf->values[pos];
+    }
+    return defaultValue;
+  }
+
+  /**
+   * @brief Remove {key, value} by specified key
+   *
+   * @param[in] key
+   */
+  void remove(const Key& key) {
+    Inner* path[MAX_HEIGHT];
+    int32_t slots[MAX_HEIGHT];
+    Leaf* leaf = descend(key, path, slots);
+    const int32_t pos = search(leaf->keys, leaf->count, key);
+    if (pos == leaf->count || compareFunc_(key, leaf->keys[pos])) {
+      return;
+    }
+
+    --size_;
+    std::move(leaf->keys + pos + 1, leaf->keys + leaf->count,
+              leaf->keys + pos);
+    std::move(leaf->values + pos + 1, leaf->values + leaf->count,
+              leaf->values + pos);
+    leaf->count--;
+    pad(leaf->keys, leaf->count);
+    // keys removed from the end of a leaf leave its upper bound in the
+    // parent as is, which is still valid
+    rebalance(path, slots, leaf->count);
+  }
+
+  /**
+   * @brief Return an iterator to the first key not smaller than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator lower_bound(const Key& key) {
+    auto [leaf, index] = lowerBoundEntry(key);
+    return iterator(leaf, index, this);
+  }
+  const_iterator lower_bound(const Key& key) const {
+    auto [leaf, index] = lowerBoundEntry(key);
+    return const_iterator(leaf, index, this);
+  }
+
+  /**
+   * @brief Return an iterator to the first key greater than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator upper_bound(const Key& key) {
+    iterator iter = lower_bound(key);
+    if (iter.leaf_ && !compareFunc_(key, iter.leaf_->keys[iter.index_])) {
+      ++iter;
+    }
+    return iter;
+  }
+  const_iterator upper_bound(const Key& key) const {
+    return const_cast<BPlusTree*>(this)->upper_bound(key);
+  }
+
+  /**
+   * @brief Check the B+-tree properties: sorted keys within the bounds of
+   * the parent, minimum fill, consistent leaf links and size
+   *
+   * @return true the tree is valid
+   */
+  bool validate() const {
+    const Leaf* prevLeaf = nullptr;
+    size_t count = 0;
+    if (!validateInternal(root_, height_, nullptr, nullptr, prevLeaf,
+                          count)) {
+      return false;
+    }
+    return prevLeaf->next == nullptr && count == size_;
+  }
+
+ private:
+  /**
+   * @brief Fill the unused key slots with the largest key, so that the SIMD
+   * search never counts them
+   *
+   * @param[in] keys
+   * @param[in] count
+   */
+  static inline void pad(Key* keys, int32_t count) {
+    if constexpr (SIMD_KEYS) {
+      std::fill(keys + count, keys + NodeKeys,
+                std::numeric_limits<int64_t>::max());
+    }
+  }
+
+  /**
+   * @brief Return the number of keys smaller than key
+   *
+   * @param[in] keys
+   * @param[in] count
+   * @param[in] key
+   * @return int32_t
+   */
+  inline int32_t search(const Key* keys, int32_t count, const Key& key) const {
+    if constexpr (SIMD_KEYS) {
+#if defined(__AVX2__)
+      const __m256i target = _mm256_set1_epi64x(key);
+      int32_t res = 0;
+      for (int32_t i = 0; i < NodeKeys; i += 4) {
+        __m256i block =
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + i));
+        __m256i less = _mm256_cmpgt_epi64(target, block);
+        res += std::popcount(static_cast<uint32_t>(
+            _mm256_movemask_pd(_mm256_castsi256_pd(less))));
+      }
+      return res;
+#elif defined(__SSE4_2__)
+      const __m128i target = _mm_set1_epi64x(key);
+      int32_t res = 0;
+      for (int32_t i = 0; i < NodeKeys; i += 2) {
+        __m128i block =
+            _mm_load_si128(reinterpret_cast<const __m128i*>(keys + i));
+        __m128i less = _mm_cmpgt_epi64(target, block);
+        res += std::popcount(static_cast<uint32_t>(
+            _mm_movemask_pd(_mm_castsi128_pd(less))));
+      }
+      return res;
+#else
+      int32_t res = 0;
+      for (int32_t i = 0; i < NodeKeys; i++) {
+        res += keys[i] < key;
+      }
+      return res;
+#endif
+    } else if constexpr (std::is_arithmetic_v<Key>) {
+      int32_t res = 0;
+      for (int32_t i = 0; i < count; i++) {
+        res += compareFunc_(keys[i], key);
+      }
+      return res;
+    } else {
+      // costly comparisons, keep their number logarithmic
+      return std::lower_bound(keys, keys + count, key, compareFunc_) - keys;
+    }
+  }
+
+  const Leaf* findLeaf(const Key& key) const {
+    void* node = root_;
+    for (int32_t level = height_; level > 0; level--) {
+      const Inner* inner = static_cast<const Inner*>(node);
+      node = inner->children[search(inner->keys, inner->count, key)];
+    }
+    return static_cast<const Leaf*>(node);
+  }
+
+  /**
+   * @brief Walk down to the leaf that holds or would hold key, recording the
+   * inner nodes on the way and the child taken in each
+   *
+   * @param[in] key
+   * @param[out] path
+   * @param[out] slots
+   * @return Leaf*
+   */
+  Leaf* descend(const Key& key, Inner** path, int32_t* slots) const {
+    void* node = root_;
+    for (int32_t depth = 0; depth < height_; depth++) {
+      Inner* inner = static_cast<Inner*>(node);
+      path[depth] = inner;
+      slots[depth] = search(inner->keys, inner->count, key);
+      node = inner->children[slots[depth]];
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  std::pair<Leaf*, int32_t> lowerBoundEntry(const Key& key) const {
+    Leaf* leaf = const_cast<Leaf*>(findLeaf(key));
+    const int32_t pos = search(leaf->keys, leaf->count, key);
+    if (pos < leaf->count) {
+      return {leaf, pos};
+    }
+    // key is above every key of the leaf but within its bound, so the
+    // answer starts the next leaf
+    return {leaf->next, 0};
+  }
+
+  Leaf* firstEntry() const { return head_->count ? head_ : nullptr; }
+
+  Leaf* lastLeaf() const {
+    void* node = root_;
+    for (int32_t level = height_; level > 0; level--) {
+      const Inner* inner = static_cast<const Inner*>(node);
+      node = inner->children[inner->count];
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  static void insertEntry(Leaf* leaf, int32_t pos, const Key& key,
+                          const Value& value) {
+    std::move_backward(leaf->keys + pos, leaf->keys + leaf->count,
+                       leaf->keys + leaf->count + 1);
+    std::move_backward(leaf->values + pos, leaf->values + leaf->count,
+                       leaf->values + leaf->count + 1);
+    leaf->keys[pos] = key;
+    leaf->values[pos] = value;
+    leaf->count++;
+  }
+
+  /**
+   * @brief Insert separator and the new node right of the split child into
+   * the recorded parents, splitting them in turn while they are full, and
+   * grow a new root if the old one splits
+   *
+   * @param[in] path
+   * @param[in] slots
+   * @param[in] separator upper bound of the split child
+   * @param[in] right the new node right of the split child
+   */
+  void insertIntoParents(Inner** path, int32_t* slots, Key separator,
+                         void* right) {
+    for (int32_t depth = height_ - 1; depth >= 0; depth--) {
+      Inner* parent = path[depth];
+      const int32_t slot = slots[depth];
+      if (parent->count < NodeKeys) {
+        std::move_backward(parent->keys + slot, parent->keys + parent->count,
+                           parent->keys + parent->count + 1);
+        std::move_backward(parent->children + slot + 1,
+                           parent->children + parent->count + 1,
+                           parent->children + parent->count + 2);
+        parent->keys[slot] = std::move(separator);
+        parent->children[slot + 1] = right;
+        parent->count++;
+        return;
+      }
+
+      // lay out the NodeKeys + 1 keys in order, keep the lower half, push
+      // the middle key up and move the upper half to a new node
+      Key keys[NodeKeys + 1];
+      void* children[NodeKeys + 2];
+      std::move(parent->keys, parent->keys + slot, keys);
+      keys[slot] = std::move(separator);
+      std::move(parent->keys + slot, parent->keys + NodeKeys, keys + slot + 1);
+      std::copy(parent->children, parent->children + slot + 1, children);
+      children[slot + 1] = right;
+      std::copy(parent->children + slot + 1, parent->children + NodeKeys + 1,
+                children + slot + 2);
+
+      Inner* sibling = new Inner();
+      parent->count = MIN_KEYS;
+      std::move(keys, keys + MIN_KEYS, parent->keys);
+      std::copy(children, children + MIN_KEYS + 1, parent->children);
+      pad(parent->keys, MIN_KEYS);
+      sibling->count = NodeKeys - MIN_KEYS;
+      std::move(keys + MIN_KEYS + 1, keys + NodeKeys + 1, sibling->keys);
+      std::copy(children + MIN_KEYS + 1, children + NodeKeys + 2,
+                sibling->children);
+      separator = std::move(keys[MIN_KEYS]);
+      right = sibling;
+    }
+
+    Inner* root = new Inner();
+    root->count = 1;
+    root->keys[0] = std::move(separator);
+    root->children[0] = root_;
+    root->children[1] = right;
+    root_ = root;
+    height_++;
+  }
+
+  /**
+   * @brief Restore the minimum fill bottom-up after a removal from the leaf
+   * at the end of path, borrowing a key from a sibling or merging with it
+   *
+   * @param[in] path
+   * @param[in] slots
+   * @param[in] count the number of keys left in the leaf
+   */
+  void rebalance(Inner** path, int32_t* slots, int32_t count) {
+    for (int32_t depth = height_ - 1; depth >= 0; depth--) {
+      if (count >= MIN_KEYS) {
+        return;
+      }
+      Inner* parent = path[depth];
+      const bool merged = depth == height_ - 1
+                              ? fixLeaf(parent, slots[depth])
+                              : fixInner(parent, slots[depth]);
+      if (!merged) {
+        return;
+      }
+      count = parent->count;
+    }
+
+    // a root left with a single child hands over to it
+    if (height_ > 0 && static_cast<Inner*>(root_)->count == 0) {
+      Inner* root = static_cast<Inner*>(root_);
+      root_ = root->children[0];
+      height_--;
+      delete root;
+    }
+  }
+
+  /**
+   * @brief Refill the underfull leaf at slot of parent from a sibling, or
+   * merge it with one
+   *
+   * @param[in] parent
+   * @param[in] slot
+   * @return true the leaf was merged, leaving one key less in parent
+   */
+  bool fixLeaf(Inner* parent, int32_t slot) {
+    Leaf* leaf = static_cast<Leaf*>(parent->children[slot]);
+    if (slot > 0) {
+      Leaf* left = static_cast<Leaf*>(parent->children[slot - 1]);
+      if (left->count > MIN_KEYS) {
+        left->count--;
+        insertEntry(leaf, 0, left->keys[left->count],
+                    left->values[left->count]);
+        pad(left->keys, left->count);
+        parent->keys[slot - 1] = left->keys[left->count - 1];
+        return false;
+      }
+    }
+    if (slot < parent->count) {
+      Leaf* right = static_cast<Leaf*>(parent->children[slot + 1]);
+      if (right->count > MIN_KEYS) {
+        leaf->keys[leaf->count] = std::move(right->keys[0]);
+        leaf->values[leaf->count] = std::move(right->values[0]);
+        leaf->count++;
+        std::move(right->keys + 1, right->keys + right->count, right->keys);
+        std::move(right->values + 1, right->values + right->count,
+                  right->values);
+        right->count--;
+        pad(right->keys, right->count);
+        parent->keys[slot] = leaf->keys[leaf->count - 1];
+        return false;
+      }
+    }
+
+    // merge into the left one of the pair, so head_ is never freed
+    const int32_t first = slot > 0 ? slot - 1 : slot;
+    Leaf* left = static_cast<Leaf*>(parent->children[first]);
+    Leaf* right = static_cast<Leaf*>(parent->children[first + 1]);
+    std::move(right->keys, right->keys + right->count,
+              left->keys + left->count);
+    std::move(right->values, right->values + right->count,
+              left->values + left->count);
+    left->count += right->count;
+    left->next = right->next;
+    if (right->next) {
+      right->next->prev = left;
+    }
+    delete right;
+    eraseChild(parent, first);
+    return true;
+  }
+
+  /**
+   * @brief Refill the underfull inner node at slot of parent from a sibling,
+   * rotating keys through parent, or merge it with one
+   *
+   * @param[in] parent
+   * @param[in] slot
+   * @return true the node was merged, leaving one key less in parent
+   */
+  bool fixInner(Inner* parent, int32_t slot) {
+    Inner* node = static_cast<Inner*>(parent->children[slot]);
+    if (slot > 0) {
+      Inner* left = static_cast<Inner*>(parent->children[slot - 1]);
+      if (left->count > MIN_KEYS) {
+        std::move_backward(node->keys, node->keys + node->count,
+                           node->keys + node->count + 1);
+        std::move_backward(node->children, node->children + node->count + 1,
+                           node->children + node->count + 2);
+        node->keys[0] = std::move(parent->keys[slot - 1]);
+        node->children[0] = left->children[left->count];
+        node->count++;
+        left->count--;
+        parent->keys[slot - 1] = std::move(left->keys[left->count]);
+        pad(left->keys, left->count);
+        return false;
+      }
+    }
+    if (slot < parent->count) {
+      Inner* right = static_cast<Inner*>(parent->children[slot + 1]);
+      if (right->count > MIN_KEYS) {
+        node->keys[node->count] = std::move(parent->keys[slot]);
+        node->children[node->count + 1] = right->children[0];
+        node->count++;
+        parent->keys[slot] = std::move(right->keys[0]);
+        std::move(right->keys + 1, right->keys + right->count, right->keys);
+        std::copy(right->children + 1, right->children + right->count + 1,
+                  right->children);
+        right->count--;
+        pad(right->keys, right->count);
+        return false;
+      }
+    }
+
+    // the separator between the pair comes down between their keys
+    const int32_t first = slot > 0 ? slot - 1 : slot;
+    Inner* left = static_cast<Inner*>(parent->children[first]);
+    Inner* right = static_cast<Inner*>(parent->children[first + 1]);
+    left->keys[left->count] = std::move(parent->keys[first]);
+    std::move(right->keys, right->keys + right->count,
+              left->keys + left->count + 1);
+    std::copy(right->children, right->children + right->count + 1,
+              left->children + left->count + 1);
+    left->count += right->count + 1;
+    delete right;
+    eraseChild(parent, first);
+    return true;
+  }
+
+  // drop keys[index] and children[index + 1] of parent
+  static void eraseChild(Inner* parent, int32_t index) {
+    std::move(parent->keys + index + 1, parent->keys + parent->count,
+              parent->keys + index);
+    std::copy(parent->children + index + 2,
+              parent->children + parent->count + 1,
+              parent->children + index + 1);
+    parent->count--;
+    pad(parent->keys, parent->count);
+  }
+
+  /**
+   * @brief Check the subtree under node, whose keys must lie in (lo, hi],
+   * visiting its leaves in order
+   *
+   * @param[in] node
+   * @param[in] level inner levels below node
+   * @param[in] lo nullptr for no lower bound
+   * @param[in] hi nullptr for no upper bound
+   * @param[in, out] prevLeaf the last leaf visited
+   * @param[in, out] count the number of entries visited
+   * @return true the subtree is valid
+   */
+  bool validateInternal(const void* node, int32_t level, const Key* lo,
+                        const Key* hi, const Leaf*& prevLeaf,
+                        size_t& count) const {
+    const bool isRoot = node == root_;
+    auto inBounds = [&](const Key& key) {
+      return (lo == nullptr || compareFunc_(*lo, key)) &&
+             (hi == nullptr || !compareFunc_(*hi, key));
+    };
+    auto sorted = [&](const Key* keys, int32_t n) {
+      for (int32_t i = 0; i < n; i++) {
+        if (!inBounds(keys[i]) ||
+            (i > 0 && !compareFunc_(keys[i - 1], keys[i]))) {
+          return false;
+        }
+      }
+      if constexpr (SIMD_KEYS) {
+        for (int32_t i = n; i < NodeKeys; i++) {
+          if (keys[i] != std::numeric_limits<int64_t>::max()) {
+            return false;
+          }
+        }
+      }
+      return true;
+    };
+
+    if (level == 0) {
+      const Leaf* leaf = static_cast<const Leaf*>(node);
+      if ((!isRoot && leaf->count < MIN_KEYS) || leaf->prev != prevLeaf ||
+          (prevLeaf && prevLeaf->next != leaf) ||
+          (prevLeaf == nullptr && leaf != head_) ||
+          !sorted(leaf->keys, leaf->count)) {
+        return false;
+      }
+      prevLeaf = leaf;
+      count += leaf->count;
+      return true;
+    }
+
+    const Inner* inner = static_cast<const Inner*>(node);
+    if ((isRoot ? inner->count < 1 : inner->count < MIN_KEYS) ||
+        !sorted(inner->keys, inner->count)) {
+      return false;
+    }
+    for (int32_t i = 0; i <= inner->count; i++) {
+      const Key* childLo = i > 0 ? &inner->keys[i - 1] : lo;
+      const Key* childHi = i < inner->count ? &inner->keys[i] : hi;
+      if (!validateInternal(inner->children[i], level - 1, childLo, childHi,
+                            prevLeaf, count)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void destroy(void* node, int32_t level) {
+    if (level == 0) {
+      delete static_cast<Leaf*>(node);
+      return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for (int32_t i = 0; i <= inner->count; i++) {
+      destroy(inner->children[i], level - 1);
+    }
+    delete inner;
+  }
+
+ private:
+  Compare compareFunc_;
+  // the leftmost leaf, never freed since merges keep the left node
+  Leaf* head_;
+  void* root_;
+  int32_t height_;
+  size_t size_;
+};
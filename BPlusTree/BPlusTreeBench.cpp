@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../RedBlackTree/RBTree.h"
+#include "BPlusTree.h"
+
+template <class Tree>
+double benchGet(const Tree& tree, const std::vector<int64_t>& probes,
+                int64_t& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t key : probes) {
+    checksum += tree.get(key, -1);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         probes.size();
+}
+
+template <class Tree>
+double benchUpsert(Tree& tree, const std::vector<int64_t>& keys) {
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t key : keys) {
+    tree.upsert(key, key & 0xff);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         keys.size();
+}
+
+/**
+ * @brief Time n random upserts then 1M random gets of present keys on Tree.
+ * Only one tree is alive at a time, so the largest sizes fit in memory.
+ *
+ * @param[in] name
+ * @param[in] keys
+ * @param[in] probes
+ * @return int64_t the checksum of the gets
+ */
+template <class Tree>
+int64_t bench(const char* name, const std::vector<int64_t>& keys,
+              const std::vector<int64_t>& probes) {
+  Tree tree;
+  double upsertNs = benchUpsert(tree, keys);
+  int64_t checksum = 0;
+  double getNs = benchGet(tree, probes, checksum);
+  std::cout << "  " << name << ": " << upsertNs << " ns/upsert, " << getNs
+            << " ns/get\n";
+  return checksum;
+}
+
+int main(int argc, char** argv) {
+  std::cout << "RBTree node " << RBTree<int64_t, int64_t>::NODE_SIZE
+            << "B, BPlusTree leaf " << BPlusTree<int64_t, int64_t>::LEAF_SIZE
+            << "B / inner " << BPlusTree<int64_t, int64_t>::INNER_SIZE
+            << "B\n";
+
+  // sizes from the command line, 1M 10M 100M by default; 100M keys need
+  // some 6 GB for the RBTree
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) {
+    sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = {1000000, 10000000, 100000000};
+  }
+
+  std::mt19937_64 gen(42);
+  for (size_t n : sizes) {
+    std::vector<int64_t> keys(n);
+    for (int64_t& key : keys) {
+      key = gen() >> 1;
+    }
+    std::vector<int64_t> probes(1000000);
+    for (int64_t& probe : probes) {
+      probe = keys[gen() % n];
+    }
+
+    std::cout << "n = " << n << ":\n";
+    int64_t rbSum = bench<RBTree<int64_t, int64_t>>("RBTree", keys, probes);
+    int64_t bpSum =
+        bench<BPlusTree<int64_t, int64_t>>("BPlusTree", keys, probes);
+    if (rbSum != bpSum) {
+      std::cout << "  MISMATCH\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BPlusTree.h"
+
+/**
+ * @brief Apply random upserts and removes to tree and a std::map, checking
+ * the tree against the map along the way
+ *
+ * @param[in] tree
+ * @param[in] keyRange
+ * @param[in] ops
+ */
+template <class Tree>
+void randomOps(Tree& tree, int64_t keyRange, int ops) {
+  std::map<int64_t, int64_t> reference;
+  std::mt19937_64 gen(7);
+  for (int op = 0; op < ops; op++) {
+    int64_t key = gen() % keyRange;
+    if (gen() % 3 == 0) {
+      tree.remove(key);
+      reference.erase(key);
+    } else {
+      tree.upsert(key, op);
+      reference[key] = op;
+    }
+    if (op % 1000 == 0) {
+      assert(tree.validate());
+    }
+  }
+  assert(tree.validate() && tree.size() == reference.size());
+  auto expected = reference.begin();
+  for (auto iter = tree.begin(); iter != tree.end(); ++iter, ++expected) {
+    assert(iter->first == expected->first &&
+           iter->second == expected->second);
+  }
+  assert(expected == reference.end());
+  for (int64_t key = -1; key <= keyRange; key += 3) {
+    auto iter = reference.find(key);
+    assert(tree.get(key, -1) == (iter == reference.end() ? -1 : iter->second));
+  }
+
+  // drain everything, which merges all the way back to a single leaf
+  for (auto [key, value] : reference) {
+    tree.remove(key);
+  }
+  assert(tree.validate() && tree.empty() && tree.height() == 0);
+  assert(tree.begin() == tree.end());
+}
+
+int main() {
+  std::cout << "## UPSERT / GET ##\n";
+  {
+    BPlusTree<int64_t, int64_t> tree;
+    for (int64_t i = 0; i < 1000; i++) {
+      tree.upsert(i * 7 % 1000, i);
+    }
+    assert(tree.validate() && tree.size() == 1000);
+    for (int64_t i = 0; i < 1000; i++) {
+      assert(tree.get(i * 7 % 1000, -1) == i);
+    }
+    assert(tree.get(1000, -1) == -1 && tree.get(-1, -1) == -1);
+    tree.upsert(INT64_MAX, 1);
+    assert(tree.get(INT64_MAX, -1) == 1 && tree.validate());
+    std::cout << "height " << tree.height() << ", leaf "
+              << BPlusTree<int64_t, int64_t>::LEAF_SIZE << "B, inner "
+              << BPlusTree<int64_t, int64_t>::INNER_SIZE << "B\n";
+  }
+
+  std::cout << "\n## RANDOM ##\n";
+  {
+    BPlusTree<int64_t, int64_t> simd;
+    randomOps(simd, 20000, 200000);
+    // the smallest nodes split and merge at every level
+    BPlusTree<int64_t, int64_t, std::less<int64_t>, 4> narrow;
+    randomOps(narrow, 5000, 100000);
+    // int32_t keys take the scalar search
+    BPlusTree<int32_t, int64_t> scalar;
+    randomOps(scalar, 5000, 100000);
+  }
+
+  std::cout << "\n## ITERATOR / BOUNDS ##\n";
+  {
+    BPlusTree<int64_t, int64_t> tree;
+    for (int64_t i = 0; i < 5000; i++) {
+      tree.upsert(i * 2, i);
+    }
+    const BPlusTree<int64_t, int64_t>& view = tree;
+    assert(view.lower_bound(101)->first == 102);
+    assert(view.lower_bound(102)->first == 102);
+    assert(view.upper_bound(102)->first == 104);
+    assert(view.lower_bound(9999) == view.end());
+    assert(tree.lower_bound(-5) == tree.begin());
+
+    int64_t expected = 9998;
+    for (auto iter = view.rbegin(); iter != view.rend(); ++iter) {
+      assert(iter->first == expected);
+      expected -= 2;
+    }
+    assert(expected == -2);
+
+    tree.lower_bound(500)->second = -1;
+    assert(view.get(500, 0) == -1);
+    auto last = tree.end();
+    assert((--last)->first == 9998);
+  }
+
+  std::cout << "\n## STRING KEYS ##\n";
+  {
+    BPlusTree<std::string, int> tree;
+    std::map<std::string, int> reference;
+    for (int i = 0; i < 3000; i++) {
+      std::string key = "key" + std::to_string(i * 37 % 3000);
+      tree.upsert(key, i);
+      reference[key] = i;
+    }
+    for (int i = 0; i < 3000; i += 2) {
+      tree.remove("key" + std::to_string(i));
+      reference.erase("key" + std::to_string(i));
+    }
+    assert(tree.validate() && tree.size() == reference.size());
+    auto expected = reference.begin();
+    for (auto [key, value] : tree) {
+      assert(key == expected->first && value == expected->second);
+      ++expected;
+    }
+  }
+
+  return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 
 template <class T>
 struct comp {
@@ -11,17 +12,31 @@ struct comp {
   }
 };
 
-template <class Value, class Compare = comp<Value>>
+template <class Value, class Compare = comp<Value>,
+          class Allocator = std::allocator<Value>>
 class BinomialHeap {
+  struct BinomialHeapNode;
+
+  // what a Handle points to: it follows a value as sifts move it between
+  // nodes, so it stays valid until the value is popped or erased
+  struct HandleSlot {
+    BinomialHeapNode* node_;
+  };
+
   struct BinomialHeapNode {
     BinomialHeapNode()
-        : degree_(0), parent_(nullptr), child_(nullptr), sibling_(nullptr) {}
-    explicit BinomialHeapNode(const Value& value)
+        : degree_(0),
+          parent_(nullptr),
+          child_(nullptr),
+          sibling_(nullptr),
+          slot_(nullptr) {}
+    BinomialHeapNode(const Value& value, HandleSlot* slot)
         : value_(value),
           degree_(0),
           parent_(nullptr),
           child_(nullptr),
-          sibling_(nullptr) {}
+          sibling_(nullptr),
+          slot_(slot) {}
     void setParent(BinomialHeapNode* newParent) {
       if (newParent == parent_) {
         return;
@@ -42,11 +57,41 @@ class BinomialHeap {
     BinomialHeapNode* parent_;
     BinomialHeapNode* child_;
     BinomialHeapNode* sibling_;
+    // the slot of the value held, null for the head
+    HandleSlot* slot_;
   };
 
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<BinomialHeapNode>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+  using SlotAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<HandleSlot>;
+  using SlotTraits = std::allocator_traits<SlotAllocator>;
+
  public:
-  BinomialHeap() : head_(new BinomialHeapNode) {}
-  explicit BinomialHeap(BinomialHeapNode* otherHead) : head_(otherHead) {}
+  /**
+   * Refers to a pushed value until it is popped or erased
+   */
+  class Handle {
+    friend class BinomialHeap;
+
+   public:
+    Handle() : slot_(nullptr) {}
+
+    bool operator==(const Handle& other) const { return slot_ == other.slot_; }
+
+   private:
+    explicit Handle(HandleSlot* slot) : slot_(slot) {}
+
+   private:
+    HandleSlot* slot_;
+  };
+
+  using value_type = Value;
+  using handle_type = Handle;
+
+  explicit BinomialHeap(const Allocator& alloc = Allocator())
+      : alloc_(alloc), slotAlloc_(alloc), head_(createNode()), minm_(nullptr) {}
   ~BinomialHeap() { destory(head_); }
 
   /**
@@ -79,19 +124,24 @@ class BinomialHeap {
     if (empty()) {
       throw "Incorrect access to empty heap.";
     }
-    return getMinmChild(head_)->value_;
+    return minm_->value_;
   }
 
   /**
    * @brief Push a new value into the heap, with potential heap refactoring
    *
    * @param[in] value
+   * @return Handle
    */
-  void push(const Value& value) {
-    BinomialHeapNode* newNode = new BinomialHeapNode(value);
+  Handle push(const Value& value) {
+    HandleSlot* slot = SlotTraits::allocate(slotAlloc_, 1);
+    BinomialHeapNode* newNode = createNode(value, slot);
+    slot->node_ = newNode;
     newNode->setParent(head_);
     newNode->setSibling(head_->child_);
     head_->child_ = mergeChildren(newNode);
+    cacheMinm(newNode);
+    return Handle(slot);
   }
 
   /**
@@ -99,34 +149,51 @@ class BinomialHeap {
    *
    */
   void pop() {
-    BinomialHeapNode* p = head_->child_;
-    BinomialHeapNode* prev = p;
-
-    BinomialHeapNode* minmNode = p;
-    BinomialHeapNode* minmPrev = prev;
+    if (empty()) {
+      throw "Incorrect access to empty heap.";
+    }
+    removeRoot(minm_);
+  }
 
-    toSibling(p);
-    while (p) {
-      if (compareFunc_(p->value_, minmNode->value_) < 0) {
-        minmNode = p;
-        minmPrev = prev;
-      }
-      toSibling(prev);
-      toSibling(p);
+  /**
+   * @brief Lower the value behind handle to value, in O(log n)
+   *
+   * @param[in] handle
+   * @param[in] value not greater than the current one
+   */
+  void decreaseKey(Handle handle, const Value& value) {
+    BinomialHeapNode* node = handle.slot_->node_;
+    if (compareFunc_(value, node->value_) > 0) {
+      throw "decreaseKey cannot increase a value.";
+    }
+    node->value_ = value;
+    while (node->parent_ != head_ &&
+           compareFunc_(node->value_, node->parent_->value_) < 0) {
+      swapValues(node, node->parent_);
+      node = node->parent_;
     }
+    cacheMinm(node);
+  }
 
-    if (minmNode == head_->child_) {
-      toSibling(head_->child_);
-    } else {
-      minmPrev->setSibling(minmNode->sibling_);
+  /**
+   * @brief Remove the value behind handle, in O(log n)
+   *
+   * @param[in] handle
+   */
+  void erase(Handle handle) {
+    BinomialHeapNode* node = handle.slot_->node_;
+    // carry the value up to its root as if it were the smallest, each
+    // ancestor moves down one level and stays in order
+    while (node->parent_ != head_) {
+      swapValues(node, node->parent_);
+      node = node->parent_;
     }
-    minmNode->setParent(nullptr);
-    minmNode->setSibling(nullptr);
-    mergeHead(minmNode);
+    removeRoot(node);
   }
 
   /**
-   * @brief Update a node with oldValue to newValue
+   * @brief Update a node with oldValue to newValue. Finding oldValue may
+   * visit every node, decreaseKey and erase take a Handle instead.
    *
    * @param[in] oldValue
    * @param[in] newValue
@@ -150,11 +217,11 @@ class BinomialHeap {
     }
 
     node->value_ = newValue;
-    if (compareResult < 0) {
+    if (compareResult > 0) {
       // Bottom-up
-      while (node->parent_ &&
+      while (node->parent_ != head_ &&
              compareFunc_(node->value_, node->parent_->value_) < 0) {
-        std::swap(node->value_, node->parent_->value_);
+        swapValues(node, node->parent_);
         node = node->parent_;
       }
     } else {
@@ -164,61 +231,35 @@ class BinomialHeap {
         if (compareFunc_(node->value_, child->value_) <= 0) {
           break;
         }
-        std::swap(node->value_, child->value_);
+        swapValues(node, child);
         node = child;
       }
     }
+    minm_ = getMinmChild(head_);
     return true;
   }
 
   /**
-   * @brief Merge with another Binomial Heap and return the merged result
+   * @brief Merge with another Binomial Heap and return the merged result. The
+   * nodes of other are adopted, so both heaps must use equal allocators, and
+   * handles into other stay valid.
    *
    * @param[in] other
    * @return BinomialHeap&
    */
   BinomialHeap& merge(BinomialHeap&& other) {
-    if (this->empty()) {
-      std::swap(head_, other.head_);
-      return *this;
-    }
     if (other.empty()) {
       return *this;
     }
 
-    BinomialHeapNode* thisCur = head_->child_;
-    BinomialHeapNode* otherCur = other.head_->child_;
-    BinomialHeapNode* tail = head_;
-
-    if (thisCur->degree_ <= otherCur->degree_) {
-      tail->child_ = thisCur;
-      toSibling(thisCur);
-    } else {
-      tail->child_ = otherCur;
-      toSibling(otherCur);
-    }
-    tail = tail->child_;
-
-    while (thisCur && otherCur) {
-      if (thisCur->degree_ <= otherCur->degree_) {
-        tail->setSibling(thisCur);
-        toSibling(thisCur);
-      } else {
-        tail->setSibling(otherCur);
-        otherCur->setParent(head_);
-        toSibling(otherCur);
-      }
-      toSibling(tail);
-    }
-    if (thisCur) {
-      tail->setSibling(thisCur);
-    }
-    if (otherCur) {
-      tail->setSibling(otherCur);
+    // adopt every root of other first, other's head is destroyed with it
+    for (auto root = other.head_->child_; root; toSibling(root)) {
+      root->setParent(head_);
     }
-
-    head_->child_ = mergeChildren(head_->child_);
+    head_->child_ = mergeRoots(head_->child_, other.head_->child_);
     other.head_->child_ = nullptr;
+    cacheMinm(other.minm_);
+    other.minm_ = nullptr;
     return *this;
   }
 
@@ -277,7 +318,7 @@ class BinomialHeap {
       return head;
     }
     for (auto child = head->child_; child; toSibling(child)) {
-      if (compareFunc_(child->value_, value) < 0) {
+      if (compareFunc_(child->value_, value) <= 0) {
         if (auto res = findNode(child, value); res) {
           return res;
         }
@@ -287,62 +328,129 @@ class BinomialHeap {
   }
 
   /**
-   * @brief Merge the given node
+   * @brief Unlink a root, make its children roots and free it
    *
-   * @param[in] head
-   * @return BinomialHeap&
+   * @param[in] root
+   */
+  void removeRoot(BinomialHeapNode* root) {
+    if (root == head_->child_) {
+      toSibling(head_->child_);
+    } else {
+      BinomialHeapNode* prev = head_->child_;
+      while (prev->sibling_ != root) {
+        toSibling(prev);
+      }
+      prev->setSibling(root->sibling_);
+    }
+    root->setParent(nullptr);
+
+    // children are linked by decreasing degree, reverse them into roots
+    BinomialHeapNode* children = nullptr;
+    while (root->child_) {
+      BinomialHeapNode* child = root->child_;
+      toSibling(root->child_);
+      child->setParent(head_);
+      child->setSibling(children);
+      children = child;
+    }
+    destroyNode(root);
+
+    head_->child_ = mergeRoots(head_->child_, children);
+    minm_ = empty() ? nullptr : getMinmChild(head_);
+  }
+
+  /**
+   * @brief Swap the values of two nodes, with the handles that follow them
+   *
+   * @param[in] lhs
+   * @param[in] rhs
+   */
+  inline void swapValues(BinomialHeapNode* lhs, BinomialHeapNode* rhs) {
+    std::swap(lhs->value_, rhs->value_);
+    std::swap(lhs->slot_, rhs->slot_);
+    lhs->slot_->node_ = lhs;
+    rhs->slot_->node_ = rhs;
+  }
+
+  /**
+   * @brief Make candidate the cached minimum if it is smaller. A tie may have
+   * linked the cached minimum below an equal node, so climb back to its root.
+   *
+   * @param[in] candidate
    */
-  BinomialHeap& mergeHead(BinomialHeapNode* head) {
-    return merge(BinomialHeap(head));
+  inline void cacheMinm(BinomialHeapNode* candidate) {
+    if (minm_ == nullptr ||
+        compareFunc_(candidate->value_, minm_->value_) < 0) {
+      minm_ = candidate;
+    }
+    while (minm_->parent_ != head_) {
+      minm_ = minm_->parent_;
+    }
   }
 
   /**
-   * @brief Reset the parent-child relationship of the given nodes
+   * @brief Reset the parent-child relationship of the given nodes. Children
+   * are kept by decreasing degree, so the new child goes first.
    *
    * @param[in] parent
    * @param[in] child
    */
   inline void mergeNode(BinomialHeapNode* parent, BinomialHeapNode* child) {
-    child->setSibling(nullptr);
+    child->setSibling(parent->child_);
+    parent->child_ = child;
+    child->setParent(parent);
+  }
 
-    if (parent->child_ == nullptr) {
-      parent->child_ = child;
-    } else {
-      BinomialHeapNode* prev = parent->child_;
-      while (prev->sibling_) {
-        toSibling(prev);
-      }
-      prev->setSibling(child);
+  /**
+   * @brief Interleave two root lists sorted by degree, then link equal degrees
+   *
+   * @param[in] lhs
+   * @param[in] rhs
+   * @return BinomialHeapNode* the first root
+   */
+  BinomialHeapNode* mergeRoots(BinomialHeapNode* lhs, BinomialHeapNode* rhs) {
+    BinomialHeapNode* first = nullptr;
+    BinomialHeapNode** tail = &first;
+    while (lhs && rhs) {
+      BinomialHeapNode*& next = lhs->degree_ <= rhs->degree_ ? lhs : rhs;
+      *tail = next;
+      tail = &next->sibling_;
+      toSibling(next);
     }
-    child->setParent(parent);
+    *tail = lhs ? lhs : rhs;
+    return first ? mergeChildren(first) : nullptr;
   }
 
   /**
-   * @brief Merge all children by degree
+   * @brief Merge all children by degree, so that no two roots share one. The
+   * list holds at most two roots of each degree.
    *
    * @param[in] node
    * @return BinomialHeapNode*
    */
   BinomialHeapNode* mergeChildren(BinomialHeapNode* node) {
     BinomialHeapNode* first = node;
-    BinomialHeapNode* second = first->sibling_;
-    if (second == nullptr) {
-      return first;
-    }
-
-    if (first->degree_ == second->degree_) {
-      if (compareFunc_(first->value_, second->value_) <= 0) {
-        first->setSibling(second->sibling_);
-        mergeNode(first, second);
+    BinomialHeapNode* prev = nullptr;
+    BinomialHeapNode* cur = node;
+    for (BinomialHeapNode* next = cur->sibling_; next; next = cur->sibling_) {
+      if (cur->degree_ != next->degree_ ||
+          (next->sibling_ && next->sibling_->degree_ == cur->degree_)) {
+        // leave a carried root to meet the next one of its degree
+        prev = cur;
+        cur = next;
+      } else if (compareFunc_(cur->value_, next->value_) <= 0) {
+        cur->setSibling(next->sibling_);
+        mergeNode(cur, next);
       } else {
-        mergeNode(second, first);
-        first = second;
+        if (prev) {
+          prev->setSibling(next);
+        } else {
+          first = next;
+        }
+        mergeNode(next, cur);
+        cur = next;
       }
     }
-
-    if (first->sibling_) {
-      first->sibling_ = mergeChildren(first->sibling_);
-    }
     return first;
   }
 
@@ -358,10 +466,29 @@ class BinomialHeap {
       toSibling(ptr);
       destory(tmp);
     }
-    delete head;
+    destroyNode(head);
+  }
+
+  template <class... Args>
+  BinomialHeapNode* createNode(Args&&... args) {
+    BinomialHeapNode* node = NodeTraits::allocate(alloc_, 1);
+    NodeTraits::construct(alloc_, node, std::forward<Args>(args)...);
+    return node;
+  }
+
+  void destroyNode(BinomialHeapNode* node) {
+    if (node->slot_) {
+      SlotTraits::deallocate(slotAlloc_, node->slot_, 1);
+    }
+    NodeTraits::destroy(alloc_, node);
+    NodeTraits::deallocate(alloc_, node, 1);
   }
 
  private:
   Compare compareFunc_;
+  NodeAllocator alloc_;
+  SlotAllocator slotAlloc_;
   BinomialHeapNode* head_;
+  // the root holding the minimum, null when empty
+  BinomialHeapNode* minm_;
 };
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "BinomialHeap.h"
+#include "DaryHeap.h"
+#include "PairingHeap.h"
+
+// (key, id), so that equal keys still pop in one order in every heap
+using Entry = std::pair<int64_t, uint32_t>;
+using StdHeap =
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+
+// std::priority_queue calls it top()
+const Entry& minimum(const StdHeap& heap) { return heap.top(); }
+template <class Heap>
+const Entry& minimum(const Heap& heap) {
+  return heap.front();
+}
+
+double nsPerOp(std::chrono::steady_clock::time_point start, size_t ops) {
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+/**
+ * @brief Push every key, then pop them all
+ *
+ * @param[in] keys
+ * @param[out] checksum
+ * @return double ns per push or pop
+ */
+template <class Heap>
+double benchPushPop(const std::vector<int64_t>& keys, int64_t& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  Heap heap;
+  for (uint32_t i = 0; i < keys.size(); i++) {
+    heap.push(Entry{keys[i], i});
+  }
+  int64_t weight = 1;
+  while (!heap.empty()) {
+    checksum += minimum(heap).first * weight++;
+    heap.pop();
+  }
+  return nsPerOp(start, keys.size() * 2);
+}
+
+/**
+ * @brief The scheduler loop: keep keys.size() timers queued, and repeatedly
+ * pop the earliest one and push it back with a later deadline
+ *
+ * @param[in] keys
+ * @param[in] rounds
+ * @param[out] checksum
+ * @return double ns per pop and push pair
+ */
+template <class Heap>
+double benchHold(const std::vector<int64_t>& keys, size_t rounds,
+                 int64_t& checksum) {
+  Heap heap;
+  for (uint32_t i = 0; i < keys.size(); i++) {
+    heap.push(Entry{keys[i], i});
+  }
+  std::mt19937_64 gen(5);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; round++) {
+    Entry entry = minimum(heap);
+    heap.pop();
+    checksum += entry.first;
+    entry.first += gen() % (1 << 20);
+    heap.push(entry);
+  }
+  return nsPerOp(start, rounds);
+}
+
+/**
+ * @brief The Dijkstra loop: pop the minimum, then lower decreases random
+ * queued keys, until the heap is empty
+ *
+ * @param[in] keys
+ * @param[in] decreases per pop
+ * @param[out] checksum
+ * @return double ns per pop or decreaseKey
+ */
+template <class Heap>
+double benchDecreaseKey(const std::vector<int64_t>& keys, int decreases,
+                        int64_t& checksum) {
+  const uint32_t n = keys.size();
+  std::vector<int64_t> current(keys);
+  // the ids still queued, and where each sits in live
+  std::vector<uint32_t> live(n), livePos(n);
+  for (uint32_t i = 0; i < n; i++) {
+    live[i] = livePos[i] = i;
+  }
+  std::mt19937_64 gen(9);
+  size_t ops = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  Heap heap;
+  std::vector<typename Heap::handle_type> handles(n);
+  for (uint32_t i = 0; i < n; i++) {
+    handles[i] = heap.push(Entry{keys[i], i});
+  }
+  while (!heap.empty()) {
+    auto [key, id] = minimum(heap);
+    heap.pop();
+    checksum += key;
+    live[livePos[id]] = live.back();
+    livePos[live.back()] = livePos[id];
+    live.pop_back();
+    ops++;
+    for (int i = 0; i < decreases && !live.empty(); i++) {
+      uint32_t target = live[gen() % live.size()];
+      current[target] -= gen() % 1024 + 1;
+      heap.decreaseKey(handles[target], Entry{current[target], target});
+      ops++;
+    }
+  }
+  return nsPerOp(start, ops);
+}
+
+/**
+ * @brief The same loop on std::priority_queue, which has no decrease-key: a
+ * lowered key is pushed again and the stale copy skipped when it surfaces
+ */
+template <>
+double benchDecreaseKey<StdHeap>(const std::vector<int64_t>& keys,
+                                 int decreases, int64_t& checksum) {
+  const uint32_t n = keys.size();
+  std::vector<int64_t> current(keys);
+  std::vector<uint32_t> live(n), livePos(n);
+  for (uint32_t i = 0; i < n; i++) {
+    live[i] = livePos[i] = i;
+  }
+  std::mt19937_64 gen(9);
+  size_t ops = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  StdHeap heap;
+  for (uint32_t i = 0; i < n; i++) {
+    heap.push(Entry{keys[i], i});
+  }
+  while (!heap.empty()) {
+    auto [key, id] = heap.top();
+    heap.pop();
+    if (key != current[id]) {
+      continue;
+    }
+    checksum += key;
+    live[livePos[id]] = live.back();
+    livePos[live.back()] = livePos[id];
+    live.pop_back();
+    ops++;
+    for (int i = 0; i < decreases && !live.empty(); i++) {
+      uint32_t target = live[gen() % live.size()];
+      current[target] -= gen() % 1024 + 1;
+      heap.push(Entry{current[target], target});
+      ops++;
+    }
+  }
+  return nsPerOp(start, ops);
+}
+
+template <class Heap>
+void bench(const char* name, const std::vector<int64_t>& keys,
+           std::vector<int64_t>& checksums) {
+  int64_t pushPop = 0, hold = 0, decrease = 0;
+  double pushPopNs = benchPushPop<Heap>(keys, pushPop);
+  double holdNs = benchHold<Heap>(keys, keys.size() * 4, hold);
+  double decreaseNs = benchDecreaseKey<Heap>(keys, 2, decrease);
+  std::cout << "  " << name << ": " << pushPopNs << " ns/push-pop, " << holdNs
+            << " ns/hold, " << decreaseNs << " ns/decrease-key mix\n";
+  checksums.insert(checksums.end(), {pushPop, hold, decrease});
+}
+
+int main(int argc, char** argv) {
+  // sizes from the command line, 10K 1M by default
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) {
+    sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = {10000, 1000000};
+  }
+
+  std::mt19937_64 gen(42);
+  for (size_t n : sizes) {
+    std::vector<int64_t> keys(n);
+    for (int64_t& key : keys) {
+      key = gen() >> 2;
+    }
+
+    std::cout << "n = " << n << ":\n";
+    std::vector<int64_t> expected, checksums;
+    bench<StdHeap>("std::priority_queue", keys, expected);
+    bench<BinomialHeap<Entry>>("BinomialHeap", keys, checksums);
+    bench<PairingHeap<Entry>>("PairingHeap", keys, checksums);
+    bench<DaryHeap<Entry>>("DaryHeap<4>", keys, checksums);
+    bench<DaryHeap<Entry, comp<Entry>, std::allocator<Entry>, 2>>(
+        "DaryHeap<2>", keys, checksums);
+    for (size_t i = 0; i < checksums.size(); i++) {
+      if (checksums[i] != expected[i % expected.size()]) {
+        std::cout << "  MISMATCH\n";
+        break;
+      }
+    }
+  }
+  return 0;
+}
@@ -1,4 +1,73 @@
+#include <cassert>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../Buddy/SlabAllocator.h"
 #include "BinomialHeap.h"
+#include "DaryHeap.h"
+#include "PairingHeap.h"
+#include "PriorityQueue.h"
+
+static_assert(AddressablePriorityQueue<BinomialHeap<int>>);
+static_assert(AddressablePriorityQueue<PairingHeap<int>>);
+static_assert(AddressablePriorityQueue<DaryHeap<int>>);
+
+/**
+ * @brief Apply random pushes, pops, decreaseKeys and erases to heap and a
+ * std::multiset, checking front() against the set after every step
+ *
+ * @param[in] heap
+ * @param[in] ops
+ */
+template <class Heap>
+void randomOps(Heap& heap, int ops) {
+  using Handle = typename Heap::handle_type;
+  std::multiset<int> reference;
+  // live handles with their current values
+  std::vector<std::pair<Handle, int>> live;
+  std::mt19937 gen(11);
+  for (int op = 0; op < ops; op++) {
+    int action = gen() % 8;
+    if (action < 3 || live.empty()) {
+      int value = gen() % 1000;
+      live.emplace_back(heap.push(value), value);
+      reference.insert(value);
+    } else if (action < 5) {
+      // erase the minimum by handle, pop() is left to the final drain as it
+      // cannot tell which of several equal values it removed
+      auto minm = std::min_element(live.begin(), live.end(),
+                                   [](const auto& lhs, const auto& rhs) {
+                                     return lhs.second < rhs.second;
+                                   });
+      assert(heap.front() == minm->second);
+      heap.erase(minm->first);
+      reference.erase(reference.find(minm->second));
+      *minm = live.back();
+      live.pop_back();
+    } else if (action < 7) {
+      auto& [handle, value] = live[gen() % live.size()];
+      reference.erase(reference.find(value));
+      value -= gen() % 100;
+      heap.decreaseKey(handle, value);
+      reference.insert(value);
+    } else {
+      size_t index = gen() % live.size();
+      heap.erase(live[index].first);
+      reference.erase(reference.find(live[index].second));
+      live[index] = live.back();
+      live.pop_back();
+    }
+    assert(heap.size() == reference.size());
+    assert(heap.empty() || heap.front() == *reference.begin());
+  }
+  while (!heap.empty()) {
+    assert(heap.front() == *reference.begin());
+    heap.pop();
+    reference.erase(reference.begin());
+  }
+  assert(reference.empty());
+}
 
 /**
  *      H
@@ -39,5 +108,108 @@ int main() {
     heap.pop();
     heap.print();
   }
+
+  std::cout << "\n## SLAB ##\n";
+  {
+    using Slab = SlabAllocator<1 << 20>;
+    using Alloc = SlabNodeAllocator<int, Slab>;
+    Slab slab;
+    BinomialHeap<int, comp<int>, Alloc> slabHeap{Alloc(slab)};
+    for (int i = 100; i > 0; i--) {
+      slabHeap.push(i);
+    }
+    for (int i = 1; i <= 50; i++) {
+      assert(slabHeap.front() == i);
+      slabHeap.pop();
+    }
+    slab.print();
+  }
+
+  std::cout << "\n## CACHED MIN ##\n";
+  {
+    BinomialHeap<int> binomial;
+    std::multiset<int> reference;
+    std::mt19937 gen(3);
+    for (int op = 0; op < 20000; op++) {
+      if (gen() % 3 || reference.empty()) {
+        int value = gen() % 500;
+        binomial.push(value);
+        reference.insert(value);
+      } else if (gen() % 8 == 0) {
+        int oldValue = *std::next(reference.begin(),
+                                  gen() % reference.size());
+        int newValue = gen() % 500;
+        assert(binomial.update(oldValue, newValue));
+        reference.erase(reference.find(oldValue));
+        reference.insert(newValue);
+      } else {
+        binomial.pop();
+        reference.erase(reference.begin());
+      }
+      if (op % 1000 == 0) {
+        BinomialHeap<int> other;
+        for (int i = 0; i < 37; i++) {
+          other.push(i * 13 % 500);
+          reference.insert(i * 13 % 500);
+        }
+        binomial.merge(std::move(other));
+        assert(other.empty());
+      }
+      assert(binomial.size() == reference.size());
+      assert(binomial.front() == *reference.begin());
+    }
+    std::cout << "size " << binomial.size() << ", min " << binomial.front()
+              << '\n';
+  }
+
+  std::cout << "\n## HANDLES ##\n";
+  {
+    BinomialHeap<int> binomial;
+    randomOps(binomial, 50000);
+
+    // handles follow their values through sifts and merges
+    BinomialHeap<int> lhs, rhs;
+    std::vector<BinomialHeap<int>::handle_type> handles;
+    for (int i = 0; i < 64; i++) {
+      handles.push_back(lhs.push(1000 + i));
+      rhs.push(2000 + i);
+    }
+    auto last = rhs.push(3000);
+    lhs.merge(std::move(rhs));
+    lhs.decreaseKey(last, 5);
+    lhs.decreaseKey(handles[63], 3);
+    assert(lhs.front() == 3);
+    lhs.erase(handles[63]);
+    assert(lhs.front() == 5);
+    lhs.erase(handles[0]);
+    lhs.pop();
+    assert(lhs.front() == 1001 && lhs.size() == 126);
+    lhs.decreaseKey(handles[40], 7);
+    assert(lhs.update(7, 9) && lhs.front() == 9);
+    lhs.erase(handles[40]);
+    assert(lhs.front() == 1001 && lhs.size() == 125);
+    std::cout << "size " << lhs.size() << ", min " << lhs.front() << '\n';
+  }
+
+  std::cout << "\n## PAIRING / D-ARY ##\n";
+  {
+    PairingHeap<int> pairing;
+    randomOps(pairing, 50000);
+    DaryHeap<int> quaternary;
+    randomOps(quaternary, 50000);
+    DaryHeap<int, comp<int>, std::allocator<int>, 2> binary;
+    randomOps(binary, 50000);
+
+    PairingHeap<int> lhs, rhs;
+    auto handle = rhs.push(7);
+    for (int i = 0; i < 100; i++) {
+      lhs.push(i * 2 + 10);
+      rhs.push(i * 2 + 11);
+    }
+    lhs.merge(std::move(rhs));
+    lhs.decreaseKey(handle, 1);
+    assert(rhs.empty() && lhs.size() == 201 && lhs.front() == 1);
+    std::cout << "pairing, 4-ary and binary heaps agree\n";
+  }
   return 0;
 }
\ No newline at end of file
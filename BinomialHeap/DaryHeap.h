@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "BinomialHeap.h"
+
+/**
+ * Implicit d-ary heap in one array. The children of entry i are entries
+ * Arity * i + 1 to Arity * i + Arity, so the tree is half as deep as a binary
+ * heap for Arity = 4 and the children compared at each step of a pop share a
+ * cache line or two. Handles are slot ids mapped to array positions, which
+ * sifts keep up to date; at most 2^32 values can be in the heap.
+ */
+template <class Value, class Compare = comp<Value>,
+          class Allocator = std::allocator<Value>, size_t Arity = 4>
+class DaryHeap {
+  static_assert(Arity >= 2);
+
+  struct Entry {
+    Value value;
+    uint32_t id;
+  };
+
+  using EntryAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Entry>;
+  using IdAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<uint32_t>;
+
+ public:
+  /**
+   * Refers to a pushed value until it is popped or erased
+   */
+  class Handle {
+    friend class DaryHeap;
+
+   public:
+    Handle() : id_(UINT32_MAX) {}
+
+    bool operator==(const Handle& other) const { return id_ == other.id_; }
+
+   private:
+    explicit Handle(uint32_t id) : id_(id) {}
+
+   private:
+    uint32_t id_;
+  };
+
+  using value_type = Value;
+  using handle_type = Handle;
+
+  explicit DaryHeap(const Allocator& alloc = Allocator())
+      : entries_(EntryAllocator(alloc)),
+        position_(IdAllocator(alloc)),
+        freeIds_(IdAllocator(alloc)) {}
+
+  inline size_t size() const { return entries_.size(); }
+
+  inline bool empty() const { return entries_.empty(); }
+
+  /**
+   * @brief Get the minimum element
+   *
+   * @return const Value&
+   */
+  inline const Value& front() const {
+    if (empty()) {
+      throw "Incorrect access to empty heap.";
+    }
+    return entries_.front().value;
+  }
+
+  /**
+   * @brief Push a new value into the heap
+   *
+   * @param[in] value
+   * @return Handle
+   */
+  Handle push(const Value& value) {
+    uint32_t id;
+    if (freeIds_.empty()) {
+      id = position_.size();
+      position_.push_back(0);
+    } else {
+      id = freeIds_.back();
+      freeIds_.pop_back();
+    }
+    entries_.push_back(Entry{value, id});
+    siftUp(entries_.size() - 1);
+    return Handle(id);
+  }
+
+  /**
+   * @brief Pop the minimum element
+   *
+   */
+  void pop() {
+    if (empty()) {
+      throw "Incorrect access to empty heap.";
+    }
+    removeAt(0);
+  }
+
+  /**
+   * @brief Lower the value behind handle to value
+   *
+   * @param[in] handle
+   * @param[in] value not greater than the current one
+   */
+  void decreaseKey(Handle handle, const Value& value) {
+    size_t index = position_[handle.id_];
+    if (compareFunc_(value, entries_[index].value) > 0) {
+      throw "decreaseKey cannot increase a value.";
+    }
+    entries_[index].value = value;
+    siftUp(index);
+  }
+
+  /**
+   * @brief Remove the value behind handle
+   *
+   * @param[in] handle
+   */
+  void erase(Handle handle) { removeAt(position_[handle.id_]); }
+
+  /**
+   * @brief Reserve room for n values
+   *
+   * @param[in] n
+   */
+  void reserve(size_t n) {
+    entries_.reserve(n);
+    position_.reserve(n);
+  }
+
+ private:
+  /**
+   * @brief Fill index with the last entry and restore the heap order
+   *
+   * @param[in] index
+   */
+  void removeAt(size_t index) {
+    freeIds_.push_back(entries_[index].id);
+    Entry last = std::move(entries_.back());
+    entries_.pop_back();
+    if (index == entries_.size()) {
+      return;
+    }
+    place(index, std::move(last));
+    if (index > 0 && compareFunc_(entries_[index].value,
+                                  entries_[(index - 1) / Arity].value) < 0) {
+      siftUp(index);
+    } else {
+      siftDown(index);
+    }
+  }
+
+  /**
+   * @brief Move an entry up to its place, shifting parents down into the hole
+   *
+   * @param[in] index
+   */
+  void siftUp(size_t index) {
+    Entry entry = std::move(entries_[index]);
+    while (index > 0) {
+      size_t parent = (index - 1) / Arity;
+      if (compareFunc_(entry.value, entries_[parent].value) >= 0) {
+        break;
+      }
+      place(index, std::move(entries_[parent]));
+      index = parent;
+    }
+    place(index, std::move(entry));
+  }
+
+  /**
+   * @brief Move an entry down to its place, shifting the smallest child up
+   * into the hole
+   *
+   * @param[in] index
+   */
+  void siftDown(size_t index) {
+    Entry entry = std::move(entries_[index]);
+    const size_t count = entries_.size();
+    for (size_t first = index * Arity + 1; first < count;
+         first = index * Arity + 1) {
+      size_t last = std::min(first + Arity, count);
+      size_t minm = first;
+      for (size_t child = first + 1; child < last; child++) {
+        if (compareFunc_(entries_[child].value, entries_[minm].value) < 0) {
+          minm = child;
+        }
+      }
+      if (compareFunc_(entries_[minm].value, entry.value) >= 0) {
+        break;
+      }
+      place(index, std::move(entries_[minm]));
+      index = minm;
+    }
+    place(index, std::move(entry));
+  }
+
+  inline void place(size_t index, Entry&& entry) {
+    position_[entry.id] = index;
+    entries_[index] = std::move(entry);
+  }
+
+ private:
+  Compare compareFunc_;
+  std::vector<Entry, EntryAllocator> entries_;
+  // array position of every id, stale for the ids in freeIds_
+  std::vector<uint32_t, IdAllocator> position_;
+  std::vector<uint32_t, IdAllocator> freeIds_;
+};
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "BinomialHeap.h"
+
+/**
+ * Pairing heap: a single heap-ordered tree whose children are a linked list.
+ * push, merge and decreaseKey are O(1), and pop melds the root's children
+ * pairwise left to right, then right to left, in O(log n) amortized.
+ */
+template <class Value, class Compare = comp<Value>,
+          class Allocator = std::allocator<Value>>
+class PairingHeap {
+  struct PairingHeapNode {
+    explicit PairingHeapNode(const Value& value)
+        : value_(value), child_(nullptr), sibling_(nullptr), prev_(nullptr) {}
+
+    Value value_;
+    PairingHeapNode* child_;
+    PairingHeapNode* sibling_;
+    // the parent of a first child, the left sibling of any other
+    PairingHeapNode* prev_;
+  };
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<PairingHeapNode>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+ public:
+  /**
+   * Refers to a pushed value until it is popped or erased
+   */
+  class Handle {
+    friend class PairingHeap;
+
+   public:
+    Handle() : node_(nullptr) {}
+
+    bool operator==(const Handle& other) const { return node_ == other.node_; }
+
+   private:
+    explicit Handle(PairingHeapNode* node) : node_(node) {}
+
+   private:
+    PairingHeapNode* node_;
+  };
+
+  using value_type = Value;
+  using handle_type = Handle;
+
+  explicit PairingHeap(const Allocator& alloc = Allocator())
+      : alloc_(alloc), root_(nullptr), size_(0) {}
+  ~PairingHeap() { destroy(root_); }
+
+  PairingHeap(const PairingHeap&) = delete;
+  PairingHeap& operator=(const PairingHeap&) = delete;
+
+  inline size_t size() const { return size_; }
+
+  inline bool empty() const { return root_ == nullptr; }
+
+  /**
+   * @brief Get the minimum element
+   *
+   * @return const Value&
+   */
+  inline const Value& front() const {
+    if (empty()) {
+      throw "Incorrect access to empty heap.";
+    }
+    return root_->value_;
+  }
+
+  /**
+   * @brief Push a new value into the heap
+   *
+   * @param[in] value
+   * @return Handle
+   */
+  Handle push(const Value& value) {
+    PairingHeapNode* node = createNode(value);
+    root_ = meld(root_, node);
+    size_++;
+    return Handle(node);
+  }
+
+  /**
+   * @brief Pop the minimum element
+   *
+   */
+  void pop() {
+    if (empty()) {
+      throw "Incorrect access to empty heap.";
+    }
+    PairingHeapNode* root = root_;
+    root_ = mergePairs(root->child_);
+    destroyNode(root);
+    size_--;
+  }
+
+  /**
+   * @brief Lower the value behind handle to value
+   *
+   * @param[in] handle
+   * @param[in] value not greater than the current one
+   */
+  void decreaseKey(Handle handle, const Value& value) {
+    PairingHeapNode* node = handle.node_;
+    if (compareFunc_(value, node->value_) > 0) {
+      throw "decreaseKey cannot increase a value.";
+    }
+    node->value_ = value;
+    if (node != root_) {
+      cut(node);
+      root_ = meld(root_, node);
+    }
+  }
+
+  /**
+   * @brief Remove the value behind handle
+   *
+   * @param[in] handle
+   */
+  void erase(Handle handle) {
+    PairingHeapNode* node = handle.node_;
+    if (node == root_) {
+      pop();
+      return;
+    }
+    cut(node);
+    root_ = meld(root_, mergePairs(node->child_));
+    destroyNode(node);
+    size_--;
+  }
+
+  /**
+   * @brief Merge with another Pairing Heap. The nodes of other are adopted, so
+   * both heaps must use equal allocators, and handles into other stay valid.
+   *
+   * @param[in] other
+   * @return PairingHeap&
+   */
+  PairingHeap& merge(PairingHeap&& other) {
+    root_ = meld(root_, other.root_);
+    size_ += other.size_;
+    other.root_ = nullptr;
+    other.size_ = 0;
+    return *this;
+  }
+
+ private:
+  /**
+   * @brief Link two detached trees, the larger root becomes the first child
+   *
+   * @param[in] lhs
+   * @param[in] rhs
+   * @return PairingHeapNode* the new root
+   */
+  PairingHeapNode* meld(PairingHeapNode* lhs, PairingHeapNode* rhs) {
+    if (lhs == nullptr) {
+      return rhs;
+    }
+    if (rhs == nullptr) {
+      return lhs;
+    }
+    if (compareFunc_(rhs->value_, lhs->value_) < 0) {
+      std::swap(lhs, rhs);
+    }
+    rhs->sibling_ = lhs->child_;
+    if (lhs->child_) {
+      lhs->child_->prev_ = rhs;
+    }
+    rhs->prev_ = lhs;
+    lhs->child_ = rhs;
+    return lhs;
+  }
+
+  /**
+   * @brief Meld a list of siblings into one tree, with the two-pass rule
+   *
+   * @param[in] first
+   * @return PairingHeapNode* the detached root, null for an empty list
+   */
+  PairingHeapNode* mergePairs(PairingHeapNode* first) {
+    // meld neighbours left to right, stacking the results through sibling_
+    PairingHeapNode* paired = nullptr;
+    while (first) {
+      PairingHeapNode* lhs = first;
+      PairingHeapNode* rhs = lhs->sibling_;
+      first = rhs ? rhs->sibling_ : nullptr;
+      detach(lhs);
+      if (rhs) {
+        detach(rhs);
+      }
+      PairingHeapNode* tree = meld(lhs, rhs);
+      tree->sibling_ = paired;
+      paired = tree;
+    }
+
+    // then fold them into one tree right to left
+    PairingHeapNode* root = nullptr;
+    while (paired) {
+      PairingHeapNode* next = paired->sibling_;
+      paired->sibling_ = nullptr;
+      root = meld(root, paired);
+      paired = next;
+    }
+    return root;
+  }
+
+  /**
+   * @brief Unlink a node, with its subtree, from its parent
+   *
+   * @param[in] node
+   */
+  void cut(PairingHeapNode* node) {
+    if (node->prev_->child_ == node) {
+      node->prev_->child_ = node->sibling_;
+    } else {
+      node->prev_->sibling_ = node->sibling_;
+    }
+    if (node->sibling_) {
+      node->sibling_->prev_ = node->prev_;
+    }
+    detach(node);
+  }
+
+  static inline void detach(PairingHeapNode* node) {
+    node->sibling_ = nullptr;
+    node->prev_ = nullptr;
+  }
+
+  /**
+   * @brief Only called by destructor. Rotates children into the sibling chain
+   * instead of recursing, since the root may have n children.
+   *
+   * @param[in] node
+   */
+  void destroy(PairingHeapNode* node) {
+    while (node) {
+      if (PairingHeapNode* child = node->child_; child) {
+        node->child_ = child->sibling_;
+        child->sibling_ = node;
+        node = child;
+      } else {
+        PairingHeapNode* next = node->sibling_;
+        destroyNode(node);
+        node = next;
+      }
+    }
+  }
+
+  PairingHeapNode* createNode(const Value& value) {
+    PairingHeapNode* node = NodeTraits::allocate(alloc_, 1);
+    NodeTraits::construct(alloc_, node, value);
+    return node;
+  }
+
+  void destroyNode(PairingHeapNode* node) {
+    NodeTraits::destroy(alloc_, node);
+    NodeTraits::deallocate(alloc_, node, 1);
+  }
+
+ private:
+  Compare compareFunc_;
+  NodeAllocator alloc_;
+  PairingHeapNode* root_;
+  size_t size_;
+};
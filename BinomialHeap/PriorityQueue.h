@@ -0,0 +1,34 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+
+/**
+ * The interface shared by BinomialHeap, PairingHeap and DaryHeap: a min-heap
+ * by Compare, with front() the smallest value.
+ */
+template <class Heap>
+concept PriorityQueue = requires(Heap heap, const Heap& constHeap,
+                                 const typename Heap::value_type& value) {
+  heap.push(value);
+  heap.pop();
+  {
+    constHeap.front()
+  } -> std::convertible_to<const typename Heap::value_type&>;
+  { constHeap.size() } -> std::convertible_to<size_t>;
+  { constHeap.empty() } -> std::convertible_to<bool>;
+};
+
+/**
+ * A PriorityQueue whose push returns a handle to the pushed value, which stays
+ * valid until that value is popped or erased.
+ */
+template <class Heap>
+concept AddressablePriorityQueue =
+    PriorityQueue<Heap> &&
+    requires(Heap heap, typename Heap::handle_type handle,
+             const typename Heap::value_type& value) {
+      { heap.push(value) } -> std::same_as<typename Heap::handle_type>;
+      heap.decreaseKey(handle, value);
+      heap.erase(handle);
+    };
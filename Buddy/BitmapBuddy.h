@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Buddy allocator with the same interface as DynamicBuddy, but free blocks are
+ * kept as one bitmap per order instead of a longest_ tree. Bit i of order k
+ * is set when the i-th block of 2^k units is free and not merged into its
+ * parent. Allocation picks the smallest non-empty order with one ctz over a
+ * mask, finds a free block with ctz over a summary word and a bitmap word,
+ * and splitting/coalescing only flips bits. A second bitmap per order records
+ * the blocks handed out, so a free is checked against the size it was
+ * allocated with.
+ */
+class BitmapBuddy {
+  class OrderBitmap {
+   public:
+    explicit OrderBitmap(uint64_t bits)
+        : words_((bits + 63) / 64, 0),
+          summary_((words_.size() + 63) / 64, 0),
+          summaryHint_(summary_.size()) {}
+
+    inline bool test(uint64_t index) const {
+      return words_[index >> 6] >> (index & 63) & 1;
+    }
+
+    inline void set(uint64_t index) {
+      uint64_t word = index >> 6;
+      words_[word] |= 1ULL << (index & 63);
+      summary_[word >> 6] |= 1ULL << (word & 63);
+      summaryHint_ = std::min(summaryHint_, word >> 6);
+    }
+
+    inline void clear(uint64_t index) {
+      uint64_t word = index >> 6;
+      words_[word] &= ~(1ULL << (index & 63));
+      if (words_[word] == 0) {
+        summary_[word >> 6] &= ~(1ULL << (word & 63));
+      }
+    }
+
+    /**
+     * @brief Return the lowest set bit, the bitmap must not be empty
+     *
+     * @return uint64_t
+     */
+    inline uint64_t findFirst() {
+      while (summary_[summaryHint_] == 0) {
+        summaryHint_++;
+      }
+      uint64_t word =
+          (summaryHint_ << 6) | std::countr_zero(summary_[summaryHint_]);
+      return (word << 6) | std::countr_zero(words_[word]);
+    }
+
+   private:
+    std::vector<uint64_t> words_;
+    // bit w is set when words_[w] is not zero
+    std::vector<uint64_t> summary_;
+    // no summary word before this one is non-zero
+    uint64_t summaryHint_;
+  };
+
+ public:
+  static constexpr uint64_t NPOS = UINT64_MAX;
+
+  explicit BitmapBuddy(uint64_t size, uint64_t minBlock = 4096)
+      : minBlock_(minBlock),
+        minBlockShift_(std::countr_zero(minBlock)),
+        maxOrder_(0),
+        nonEmptyOrders_(0) {
+    if (!std::has_single_bit(size) || !std::has_single_bit(minBlock) ||
+        minBlock > size) {
+      throw "Buddy size and minimum block size must be powers of 2";
+    }
+
+    maxOrder_ = std::countr_zero(size >> minBlockShift_);
+    if (maxOrder_ >= 64) {
+      throw "Buddy has too many orders";
+    }
+    for (uint32_t order = 0; order <= maxOrder_; order++) {
+      bitmaps_.emplace_back(1ULL << (maxOrder_ - order));
+      allocated_.emplace_back(1ULL << (maxOrder_ - order));
+    }
+    setFree(maxOrder_, 0);
+  }
+  ~BitmapBuddy() = default;
+
+  BitmapBuddy(const BitmapBuddy&) = delete;
+  BitmapBuddy& operator=(const BitmapBuddy&) = delete;
+  BitmapBuddy(BitmapBuddy&&) = default;
+  BitmapBuddy& operator=(BitmapBuddy&&) = default;
+
+  /**
+   * @brief Allocate a block of at least size bytes and return its offset, or
+   * NPOS if no free block is large enough
+   *
+   * @param[in] size
+   * @return uint64_t
+   */
+  uint64_t alloc(uint64_t size) {
+    if (size == 0 || size > capacity()) {
+      return NPOS;
+    }
+
+    const uint32_t order = orderOf(size);
+    const uint64_t candidates = nonEmptyOrders_ >> order;
+    if (candidates == 0) {
+      return NPOS;
+    }
+
+    uint32_t curOrder = order + std::countr_zero(candidates);
+    uint64_t index = bitmaps_[curOrder].findFirst();
+    setUsed(curOrder, index);
+    // split, keeping the left half and freeing the right one on every order
+    while (curOrder > order) {
+      curOrder--;
+      index <<= 1;
+      setFree(curOrder, index | 1);
+    }
+    allocated_[order].set(index);
+    return (index << order) << minBlockShift_;
+  }
+
+  /**
+   * @brief Free the block of size bytes allocated at offset
+   *
+   * @param[in] offset
+   * @param[in] size
+   */
+  void free(uint64_t offset, uint64_t size) {
+    if (size == 0 || size > capacity() || offset >= capacity() ||
+        (offset & (minBlock_ - 1))) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    uint32_t order = orderOf(size);
+    uint64_t index = offset >> minBlockShift_;
+    if (index & ((1ULL << order) - 1)) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    index >>= order;
+
+    for (uint32_t curOrder = order; curOrder <= maxOrder_; curOrder++) {
+      if (bitmaps_[curOrder].test(index >> (curOrder - order))) {
+        throw "Double Free at offset " + std::to_string(offset);
+      }
+    }
+    // e.g. a block of twice the size freed over a split one
+    if (!allocated_[order].test(index)) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    allocated_[order].clear(index);
+
+    // merge with the buddy as long as it is free as a whole
+    while (order < maxOrder_ && bitmaps_[order].test(index ^ 1)) {
+      setUsed(order, index ^ 1);
+      index >>= 1;
+      order++;
+    }
+    setFree(order, index);
+  }
+
+  inline uint64_t capacity() const { return minBlock_ << maxOrder_; }
+
+  inline uint64_t minBlock() const { return minBlock_; }
+
+  /**
+   * @brief Return log2 of the number of minimum blocks used to serve size bytes
+   *
+   * @param[in] size
+   * @return uint32_t
+   */
+  inline uint32_t orderOf(uint64_t size) const {
+    uint64_t units = (size + minBlock_ - 1) >> minBlockShift_;
+    return std::bit_width(units - 1);
+  }
+
+  /**
+   * @brief Return the size of the largest block that can still be allocated
+   *
+   * @return uint64_t
+   */
+  inline uint64_t largestFree() const {
+    return nonEmptyOrders_ ? minBlock_ << (std::bit_width(nonEmptyOrders_) - 1)
+                           : 0;
+  }
+
+  /* Only for debug */
+  void print() const {
+    std::cout << "Capacity: " << capacity() << ", min block: " << minBlock_
+              << ", largest free block: " << largestFree() << '\n';
+  }
+
+ private:
+  inline void setFree(uint32_t order, uint64_t index) {
+    bitmaps_[order].set(index);
+    if (freeCount_[order]++ == 0) {
+      nonEmptyOrders_ |= 1ULL << order;
+    }
+  }
+
+  inline void setUsed(uint32_t order, uint64_t index) {
+    bitmaps_[order].clear(index);
+    if (--freeCount_[order] == 0) {
+      nonEmptyOrders_ &= ~(1ULL << order);
+    }
+  }
+
+ private:
+  uint64_t minBlock_;
+  uint32_t minBlockShift_;
+  uint32_t maxOrder_;
+
+  std::vector<OrderBitmap> bitmaps_;
+  // bit i of order k is set when the i-th block of 2^k units is allocated
+  std::vector<OrderBitmap> allocated_;
+  uint64_t freeCount_[64] = {};
+  // bit k is set when order k has at least one free block
+  uint64_t nonEmptyOrders_;
+};
@@ -2,13 +2,43 @@
 
 #include <cstdint>
 #include <iostream>
-#include <numeric>
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <string>
+#include <vector>
 
 template <int Size>
 class Buddy {
+  static constexpr uint32_t ORDERS = std::bit_width(uint32_t(Size));
+
  public:
-  Buddy() {
+  struct Stats {
+    uint32_t capacity;
+    // sum of the power of 2 blocks handed out, and of the sizes asked for
+    uint32_t bytesAllocated;
+    uint32_t bytesRequested;
+    uint32_t internalFragmentation;
+    uint32_t bytesFree;
+    uint32_t largestFree;
+    // freeBlocks[k] is the number of free blocks of 2^k bytes
+    std::array<uint32_t, ORDERS> freeBlocks;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t failures;
+    // requestHistogram[k] counts requests rounded up to 2^k bytes, only
+    // filled while the histogram is enabled
+    std::array<uint64_t, ORDERS> requestHistogram;
+  };
+
+  Buddy()
+      : bytesAllocated_(0),
+        bytesRequested_(0),
+        allocs_(0),
+        frees_(0),
+        failures_(0),
+        histogramEnabled_(false),
+        histogram_{} {
     uint32_t index = ROOT;
     uint32_t levelNodes = 1;
     for (uint32_t nodeSize = Size; nodeSize >= 1; nodeSize >>= 1) {
@@ -26,8 +56,17 @@ class Buddy {
   Buddy& operator=(Buddy&&) = delete;
 
   uint32_t alloc(uint32_t size) {
-    size = nextPow2(size);
+    if (size > Size) {
+      failures_++;
+      return -1;
+    }
+    const uint32_t requested = size;
+    size = blockSize(size);
+    if (histogramEnabled_) {
+      histogram_[std::countr_zero(size)]++;
+    }
     if (getNodeLongestSize(ROOT) < size) {
+      failures_++;
       return -1;
     }
 
@@ -47,50 +86,174 @@ class Buddy {
       longest_[curNode] =
           std::max(longest_[leftChild(curNode)], longest_[rightChild(curNode)]);
     }
+
+    allocs_++;
+    bytesAllocated_ += size;
+    bytesRequested_ += requested;
     return offset;
   }
 
   void free(uint32_t offset, uint32_t size) {
-    size = nextPow2(size);
+    if (size > Size) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    const uint32_t requested = size;
+    size = blockSize(size);
 
-    uint32_t curNode = ROOT;
-    while (true) {
-      uint32_t nodeOffset = getNodeOffset(curNode);
-      uint32_t nodeSize = getNodeSize(curNode);
+    uint32_t curNode = locate(offset, size);
+    longest_[curNode] = binaryDigits(size);
+    while (curNode != ROOT) {
+      curNode = parent(curNode);
+      updateNode(curNode);
+    }
 
-      if (offset == nodeOffset) {
-        if (size > nodeSize) {
-          throw "Invalid size free at offset" + std::to_string(offset);
-        }
-        if (size == nodeSize) {
-          if (longest_[curNode] > 0) {
-            throw "Double Free at offset " + std::to_string(offset);
-          }
-          longest_[curNode] = binaryDigits(nodeSize);
-          break;
+    frees_++;
+    bytesAllocated_ -= size;
+    bytesRequested_ -= requested;
+  }
+
+  /**
+   * @brief Allocate count blocks of size bytes and write their offsets to out.
+   * Instead of one descend per block, the largest free block that the
+   * remaining count can fill is carved into many blocks at once, so longest_
+   * above it is only recomputed once per carved block.
+   *
+   * @param[in] size
+   * @param[in] count
+   * @param[out] out
+   * @return uint32_t the number of blocks allocated, smaller than count if
+   * the buddy ran out of space
+   */
+  uint32_t allocBatch(uint32_t size, uint32_t count, uint32_t* out) {
+    if (size > Size) {
+      failures_ += count;
+      return 0;
+    }
+    const uint32_t requested = size;
+    size = blockSize(size);
+    if (histogramEnabled_) {
+      histogram_[std::countr_zero(size)] += count;
+    }
+
+    uint32_t done = 0;
+    while (done < count && getNodeLongestSize(ROOT) >= size) {
+      uint32_t remaining = std::min(count - done, Size / size);
+      uint32_t chunk = std::min(std::bit_floor(remaining) * size,
+                                getNodeLongestSize(ROOT));
+
+      uint32_t curNode = ROOT;
+      while (getNodeSize(curNode) > chunk) {
+        if (getNodeLongestSize(leftChild(curNode)) >= chunk) {
+          curNode = leftChild(curNode);
+        } else {
+          curNode = rightChild(curNode);
         }
       }
 
-      uint32_t mid = std::midpoint(nodeOffset, nodeSize);
-      if (offset < mid) {
-        curNode = leftChild(curNode);
-      } else {
-        curNode = rightChild(curNode);
+      // every node of the carved subtree down to the block size is used
+      uint32_t first = curNode;
+      uint32_t width = 1;
+      for (uint32_t nodeSize = chunk; nodeSize >= size; nodeSize >>= 1) {
+        std::fill(longest_ + first, longest_ + first + width, 0);
+        first <<= 1;
+        width <<= 1;
+      }
+      uint32_t offset = getNodeOffset(curNode);
+      for (uint32_t i = 0; i < chunk / size; i++) {
+        out[done++] = offset + i * size;
+      }
+
+      while (curNode != ROOT) {
+        curNode = parent(curNode);
+        longest_[curNode] = std::max(longest_[leftChild(curNode)],
+                                     longest_[rightChild(curNode)]);
       }
     }
 
-    while (curNode != ROOT) {
-      curNode = parent(curNode);
-      if (getNodeLongestSize(leftChild(curNode)) !=
-              getNodeSize(leftChild(curNode)) ||
-          getNodeLongestSize(rightChild(curNode)) !=
-              getNodeSize(rightChild(curNode))) {
-        break;
+    failures_ += count - done;
+    allocs_ += done;
+    bytesAllocated_ += done * size;
+    bytesRequested_ += done * requested;
+    return done;
+  }
+
+  /**
+   * @brief Free count blocks of size bytes. Every offset is checked before
+   * anything is freed, then longest_ is rebuilt one level at a time so that
+   * an ancestor shared by several blocks is only recomputed once.
+   *
+   * @param[in] offsets
+   * @param[in] count
+   * @param[in] size
+   */
+  void freeBatch(const uint32_t* offsets, uint32_t count, uint32_t size) {
+    if (size > Size && count > 0) {
+      throw "Invalid size free at offset " + std::to_string(offsets[0]);
+    }
+    const uint32_t requested = size;
+    size = blockSize(size);
+
+    std::vector<uint32_t> nodes(count);
+    for (uint32_t i = 0; i < count; i++) {
+      nodes[i] = locate(offsets[i], size);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    auto dup = std::adjacent_find(nodes.begin(), nodes.end());
+    if (dup != nodes.end()) {
+      throw "Double Free at offset " + std::to_string(getNodeOffset(*dup));
+    }
+
+    for (uint32_t node : nodes) {
+      longest_[node] = binaryDigits(size);
+    }
+    // all nodes sit on the same level, so their parents stay sorted
+    while (!nodes.empty() && nodes.front() != ROOT) {
+      uint32_t level = 0;
+      for (uint32_t node : nodes) {
+        uint32_t p = parent(node);
+        if (level == 0 || nodes[level - 1] != p) {
+          nodes[level++] = p;
+          updateNode(p);
+        }
       }
-      longest_[curNode] = binaryDigits(getNodeSize(curNode));
+      nodes.resize(level);
     }
+
+    frees_ += count;
+    bytesAllocated_ -= count * size;
+    bytesRequested_ -= count * requested;
   }
 
+  /**
+   * @brief Return usage, fragmentation and counters. Counters are maintained
+   * on alloc/free, the free block census walks only the partially allocated
+   * part of the tree.
+   *
+   * @return Stats
+   */
+  Stats stats() const {
+    Stats res{};
+    res.capacity = Size;
+    res.bytesAllocated = bytesAllocated_;
+    res.bytesRequested = bytesRequested_;
+    res.internalFragmentation = bytesAllocated_ - bytesRequested_;
+    res.bytesFree = Size - bytesAllocated_;
+    res.largestFree = getNodeLongestSize(ROOT);
+    countFreeBlocks(ROOT, res.freeBlocks);
+    res.allocs = allocs_;
+    res.frees = frees_;
+    res.failures = failures_;
+    res.requestHistogram = histogram_;
+    return res;
+  }
+
+  /**
+   * @brief Start or stop recording the histogram of request sizes
+   *
+   * @param[in] enabled
+   */
+  inline void enableHistogram(bool enabled) { histogramEnabled_ = enabled; }
+
   void print() {
     char str[Size + 1];
     toString(ROOT, str);
@@ -99,8 +262,8 @@ class Buddy {
   }
 
  private:
-  inline bool isPow2(uint32_t x) { return (x & (-x)) == x; }
-  inline uint32_t nextPow2(uint32_t x) {
+  inline bool isPow2(uint32_t x) const { return (x & (-x)) == x; }
+  inline uint32_t nextPow2(uint32_t x) const {
     if (isPow2(x)) return x;
 
     x |= x >> 1;
@@ -110,7 +273,12 @@ class Buddy {
     x |= x >> 16;
     return ++x;
   }
-  inline uint32_t binaryDigits(uint32_t x) {
+  // the block serving a request of at most Size bytes, a zero-byte request
+  // still takes a leaf
+  inline uint32_t blockSize(uint32_t size) const {
+    return size == 0 ? 1 : nextPow2(size);
+  }
+  inline uint32_t binaryDigits(uint32_t x) const {
     uint32_t d = 0;
     while (x) {
       ++d;
@@ -119,24 +287,91 @@ class Buddy {
     return d;
   }
 
-  inline uint32_t leftChild(uint32_t index) { return index << 1; }
+  inline uint32_t leftChild(uint32_t index) const { return index << 1; }
 
-  inline uint32_t parent(uint32_t index) { return index >> 1; }
+  inline uint32_t parent(uint32_t index) const { return index >> 1; }
 
-  inline uint32_t rightChild(uint32_t index) { return (index << 1) + 1; }
+  inline uint32_t rightChild(uint32_t index) const { return (index << 1) + 1; }
 
-  inline uint32_t getNodeOffset(uint32_t index) {
+  inline uint32_t getNodeOffset(uint32_t index) const {
     return (index ^ (1 << (binaryDigits(index) - 1))) * getNodeSize(index);
   }
 
-  inline uint32_t getNodeSize(uint32_t index) {
+  inline uint32_t getNodeSize(uint32_t index) const {
     return Size >> (binaryDigits(index) - 1);
   }
 
-  inline uint32_t getNodeLongestSize(uint32_t index) {
+  inline uint32_t getNodeLongestSize(uint32_t index) const {
     return longest_[index] == 0 ? 0 : 1 << (longest_[index] - 1);
   }
 
+  /**
+   * @brief Return the node of the allocated block of size bytes at offset
+   *
+   * @param[in] offset
+   * @param[in] size a power of 2
+   * @return uint32_t
+   */
+  uint32_t locate(uint32_t offset, uint32_t size) {
+    uint32_t curNode = ROOT;
+    while (true) {
+      uint32_t nodeOffset = getNodeOffset(curNode);
+      uint32_t nodeSize = getNodeSize(curNode);
+
+      if (offset == nodeOffset) {
+        if (size > nodeSize) {
+          throw "Invalid size free at offset" + std::to_string(offset);
+        }
+        if (size == nodeSize) {
+          if (longest_[curNode] > 0) {
+            throw "Double Free at offset " + std::to_string(offset);
+          }
+          return curNode;
+        }
+      }
+
+      uint32_t mid = nodeOffset + nodeSize / 2;
+      if (offset < mid) {
+        curNode = leftChild(curNode);
+      } else {
+        curNode = rightChild(curNode);
+      }
+    }
+  }
+
+  /**
+   * @brief Recompute longest_ of an inner node from its children, merging
+   * two fully free buddies
+   *
+   * @param[in] index
+   */
+  void updateNode(uint32_t index) {
+    if (getNodeLongestSize(leftChild(index)) ==
+            getNodeSize(leftChild(index)) &&
+        getNodeLongestSize(rightChild(index)) ==
+            getNodeSize(rightChild(index))) {
+      longest_[index] = binaryDigits(getNodeSize(index));
+    } else {
+      longest_[index] =
+          std::max(longest_[leftChild(index)], longest_[rightChild(index)]);
+    }
+  }
+
+  void countFreeBlocks(uint32_t index,
+                       std::array<uint32_t, ORDERS>& freeBlocks) const {
+    uint32_t longest = getNodeLongestSize(index);
+    uint32_t size = getNodeSize(index);
+    if (longest == 0) {
+      return;
+    }
+    if (longest == size) {
+      freeBlocks[std::countr_zero(size)]++;
+      return;
+    }
+    countFreeBlocks(leftChild(index), freeBlocks);
+    countFreeBlocks(rightChild(index), freeBlocks);
+  }
+
   void toString(uint32_t index, char* out) {
     if (index > 2 * Size) return;
     uint32_t start = getNodeOffset(index);
@@ -160,4 +395,12 @@ class Buddy {
   static const uint32_t ROOT = 1;
 
   uint8_t longest_[2 * Size];
+
+  uint32_t bytesAllocated_;
+  uint32_t bytesRequested_;
+  uint64_t allocs_;
+  uint64_t frees_;
+  uint64_t failures_;
+  bool histogramEnabled_;
+  std::array<uint64_t, ORDERS> histogram_;
 };
\ No newline at end of file
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+#include "Buddy.h"
+
+/**
+ * Buddy allocator backed by real memory. The arena owns Size bytes, either
+ * from the heap or from an anonymous mmap, and hands out blocks of at least
+ * MinBlock bytes. The arena itself is aligned to Size, so every block is
+ * aligned to its own size. The order of every allocated block is recorded, so
+ * free only needs the pointer.
+ */
+template <int Size, int MinBlock = 64>
+class BuddyArena {
+  static_assert(std::has_single_bit(static_cast<uint32_t>(Size)) &&
+                std::has_single_bit(static_cast<uint32_t>(MinBlock)) &&
+                MinBlock <= Size);
+  static constexpr uint32_t UNITS = Size / MinBlock;
+  static constexpr size_t PAGE_SIZE = 4096;
+  static constexpr size_t ALIGNMENT = std::max<size_t>(Size, PAGE_SIZE);
+
+ public:
+  explicit BuddyArena(bool useMmap = false) : mapped_(useMmap), orders_{} {
+    if (mapped_) {
+      // mmap only aligns to a page: map Size spare bytes and trim both ends
+      const size_t spare = ALIGNMENT > PAGE_SIZE ? ALIGNMENT : 0;
+      const size_t length = Size + spare;
+      void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      char* mapped = static_cast<char*>(ptr);
+      uintptr_t address = reinterpret_cast<uintptr_t>(mapped);
+      base_ = mapped + ((ALIGNMENT - address % ALIGNMENT) % ALIGNMENT);
+      if (base_ > mapped) {
+        munmap(mapped, base_ - mapped);
+      }
+      if (base_ + Size < mapped + length) {
+        munmap(base_ + Size, mapped + length - (base_ + Size));
+      }
+    } else {
+      base_ = static_cast<char*>(
+          ::operator new(Size, std::align_val_t(ALIGNMENT)));
+    }
+  }
+  ~BuddyArena() {
+    if (mapped_) {
+      munmap(base_, Size);
+    } else {
+      ::operator delete(base_, std::align_val_t(ALIGNMENT));
+    }
+  }
+
+  BuddyArena(const BuddyArena&) = delete;
+  BuddyArena& operator=(const BuddyArena&) = delete;
+  BuddyArena(BuddyArena&&) = delete;
+  BuddyArena& operator=(BuddyArena&&) = delete;
+
+  /**
+   * @brief Allocate a block of at least size bytes, aligned to its own
+   * (power of two) size. Return nullptr if no block is large enough.
+   *
+   * @param[in] size
+   * @param[in] alignment a power of 2, served by growing the block to it
+   * @return void*
+   */
+  void* alloc(size_t size, size_t alignment = 1) {
+    size = std::max(size, alignment);
+    if (size == 0 || size > static_cast<size_t>(Size)) {
+      return nullptr;
+    }
+
+    uint32_t units = std::bit_ceil(static_cast<uint32_t>(
+        (size + MinBlock - 1) / MinBlock));
+    uint32_t offset = buddy_.alloc(units);
+    if (offset == static_cast<uint32_t>(-1)) {
+      return nullptr;
+    }
+    orders_[offset] = std::countr_zero(units);
+    return base_ + static_cast<size_t>(offset) * MinBlock;
+  }
+
+  /**
+   * @brief Free a block returned by alloc
+   *
+   * @param[in] ptr
+   */
+  void free(void* ptr) {
+    if (ptr == nullptr) {
+      return;
+    }
+    if (!owns(ptr)) {
+      throw "Free of a pointer not owned by the arena";
+    }
+    uint32_t offset = unitOffset(ptr);
+    buddy_.free(offset, 1u << orders_[offset]);
+  }
+
+  /**
+   * @brief Return the usable size of an allocated block
+   *
+   * @param[in] ptr
+   * @return size_t
+   */
+  inline size_t blockSize(void* ptr) const {
+    return static_cast<size_t>(MinBlock) << orders_[unitOffset(ptr)];
+  }
+
+  inline bool owns(void* ptr) const {
+    char* p = static_cast<char*>(ptr);
+    return p >= base_ && p < base_ + Size;
+  }
+
+  inline size_t capacity() const { return Size; }
+
+  inline char* data() const { return base_; }
+
+  /* Only for debug */
+  void print() { buddy_.print(); }
+
+ private:
+  inline uint32_t unitOffset(void* ptr) const {
+    return (static_cast<char*>(ptr) - base_) / MinBlock;
+  }
+
+ private:
+  char* base_;
+  bool mapped_;
+  Buddy<UNITS> buddy_;
+  // log2 of the block length in units, indexed by the block's first unit
+  uint8_t orders_[UNITS];
+};
+
+/**
+ * std::pmr adapter so that pmr containers can draw their memory from a buddy
+ * arena. Arena needs alloc(size, alignment) returning nullptr on failure and
+ * free(ptr).
+ */
+template <class Arena>
+class BuddyMemoryResource : public std::pmr::memory_resource {
+ public:
+  explicit BuddyMemoryResource(Arena& arena) : arena_(arena) {}
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    void* ptr = arena_.alloc(bytes, alignment);
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+
+  void do_deallocate(void* ptr, size_t, size_t) override { arena_.free(ptr); }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+ private:
+  Arena& arena_;
+};
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BitmapBuddy.h"
+#include "ConcurrentBuddy.h"
+#include "DynamicBuddy.h"
+
+constexpr int OPS_PER_THREAD = 200000;
+
+// blocks of 64 << (shift + 0..2) bytes: shift 0 stays in the per-CPU
+// caches, shift 4 goes to the striped regions on every call
+template <class Alloc, class Free>
+double run(int threads, int shift, Alloc&& alloc, Free&& free) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&alloc, &free, t, shift]() {
+      std::vector<std::pair<uint64_t, uint64_t>> live;
+      for (int i = 0; i < OPS_PER_THREAD; i++) {
+        uint64_t size = 64 << (shift + (i + t) % 3);
+        live.emplace_back(alloc(size), size);
+        if (live.size() == 32) {
+          for (auto [offset, sz] : live) free(offset, sz);
+          live.clear();
+        }
+      }
+      for (auto [offset, sz] : live) free(offset, sz);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return threads * OPS_PER_THREAD / seconds / 1e6;
+}
+
+template <class Allocator>
+double latency(Allocator& allocator) {
+  std::vector<uint64_t> offsets(1024);
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < 1000; round++) {
+    for (uint64_t& offset : offsets) {
+      offset = allocator.alloc(64);
+    }
+    for (uint64_t offset : offsets) {
+      allocator.free(offset, 64);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (1000 * offsets.size());
+}
+
+int main() {
+  {
+    DynamicBuddy tree(1ULL << 34, 64);
+    BitmapBuddy bitmap(1ULL << 34, 64);
+    std::cout << "16 GiB of 64 B units, alloc+free of one unit: tree "
+              << latency(tree) << " ns, bitmap " << latency(bitmap) << " ns\n";
+  }
+
+  std::cout << "ConcurrentBuddy stripes 1 GiB into "
+            << ConcurrentBuddy(1ULL << 30, 64).regions() << " regions\n";
+  for (int shift : {0, 4}) {
+    std::cout << (shift ? "blocks of 1-4 KiB:\n" : "blocks of 64-256 B:\n");
+    for (int threads : {1, 2, 4, 8, 16}) {
+      DynamicBuddy buddy(1ULL << 30, 64);
+      std::mutex mutex;
+      double locked = run(
+          threads, shift,
+          [&](uint64_t size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return buddy.alloc(size);
+          },
+          [&](uint64_t offset, uint64_t size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buddy.free(offset, size);
+          });
+
+      ConcurrentBuddy pool(1ULL << 30, 64);
+      double striped = run(
+          threads, shift, [&](uint64_t size) { return pool.alloc(size); },
+          [&](uint64_t offset, uint64_t size) { pool.free(offset, size); });
+
+      std::cout << "  " << threads << " threads: global mutex " << locked
+                << " Mops/s, ConcurrentBuddy " << striped << " Mops/s\n";
+    }
+  }
+  return 0;
+}
@@ -1,7 +1,21 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include "Buddy.h"
+#include "BitmapBuddy.h"
+#include "BuddyArena.h"
+#include "ConcurrentBuddy.h"
+#include "DynamicBuddy.h"
+#include "SlabAllocator.h"
 
 int main() {
   Buddy<8> buddy;
+  buddy.enableHistogram(true);
   std::cout << "## ALLOC ##\n";
   {
     uint32_t off1 = buddy.alloc(1);
@@ -15,6 +29,18 @@ int main() {
     uint32_t off3 = buddy.alloc(3);
     std::cout << "alloc 3B at offset " << off3 << '\n';
     buddy.print();
+
+    assert(buddy.alloc(4) == static_cast<uint32_t>(-1));
+    auto stats = buddy.stats();
+    std::cout << "allocated " << stats.bytesAllocated << "B for "
+              << stats.bytesRequested << "B requested, "
+              << stats.internalFragmentation << "B lost to rounding, "
+              << stats.bytesFree << "B free (largest " << stats.largestFree
+              << "B), " << stats.failures << " failure\n";
+    assert(stats.bytesAllocated == 7 && stats.internalFragmentation == 1);
+    assert(stats.freeBlocks[0] == 1 && stats.largestFree == 1);
+    assert(stats.allocs == 3 && stats.failures == 1);
+    assert(stats.requestHistogram[2] == 2);
   }
 
   std::cout << "\n## FREE ##\n";
@@ -32,5 +58,361 @@ int main() {
     buddy.print();
   }
 
+  std::cout << "\n## BATCH ##\n";
+  {
+    Buddy<64> batch;
+    uint32_t single = batch.alloc(4);
+    uint32_t offsets[16];
+    // 16 blocks of 4B do not fit next to the first one, only 15 do
+    uint32_t n = batch.allocBatch(3, 16, offsets);
+    std::cout << "allocBatch got " << n << " blocks of 4B\n";
+    batch.print();
+    assert(n == 15);
+    std::vector<bool> used(16, false);
+    used[single / 4] = true;
+    for (uint32_t i = 0; i < n; i++) {
+      assert(offsets[i] % 4 == 0 && !used[offsets[i] / 4]);
+      used[offsets[i] / 4] = true;
+    }
+
+    // free every other block first, then the rest, which must coalesce all
+    uint32_t even[8], odd[8];
+    uint32_t evenCount = 0, oddCount = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      if (offsets[i] / 4 % 2 == 0) {
+        even[evenCount++] = offsets[i];
+      } else {
+        odd[oddCount++] = offsets[i];
+      }
+    }
+    batch.freeBatch(even, evenCount, 3);
+    batch.print();
+    assert(batch.stats().largestFree == 4);
+    batch.freeBatch(odd, oddCount, 3);
+    batch.free(single, 4);
+    batch.print();
+    assert(batch.stats().largestFree == 64);
+
+    bool threw = false;
+    try {
+      batch.alloc(8);
+      uint32_t twice[2] = {0, 0};
+      batch.freeBatch(twice, 2, 8);
+    } catch (const std::string&) {
+      threw = true;
+    }
+    assert(threw && batch.stats().largestFree == 32);
+    std::cout << "batch alloc/free passed\n";
+  }
+
+  {
+    // zero-byte requests take a leaf each, like one-byte ones
+    Buddy<64> zero;
+    const Buddy<64>& view = zero;
+    uint32_t first = zero.alloc(0);
+    uint32_t second = zero.alloc(0);
+    assert(first != second && first < 64 && second < 64);
+    assert(view.stats().bytesAllocated == 2 && view.stats().largestFree == 32);
+    zero.free(first, 0);
+    zero.free(second, 0);
+    assert(view.stats().bytesAllocated == 0 && view.stats().largestFree == 64);
+
+    uint32_t offsets[4];
+    assert(zero.allocBatch(0, 4, offsets) == 4);
+    zero.freeBatch(offsets, 4, 0);
+    assert(view.stats().bytesAllocated == 0 && view.stats().largestFree == 64);
+    std::cout << "zero-byte alloc/free passed\n";
+
+    // sizes whose next power of 2 overflows must fail, not wrap to a leaf
+    assert(zero.alloc(0x80000001u) == static_cast<uint32_t>(-1));
+    assert(zero.allocBatch(0x80000001u, 2, offsets) == 0);
+    assert(view.stats().failures == 3 && view.stats().bytesAllocated == 0);
+    bool threw = false;
+    try {
+      zero.free(0, 0x80000001u);
+    } catch (const std::string&) {
+      threw = true;
+    }
+    assert(threw && view.stats().largestFree == 64);
+    std::cout << "oversized alloc/free passed\n";
+  }
+
+  std::cout << "\n## ARENA ##\n";
+  {
+    BuddyArena<1 << 12, 64> arena(true);
+    void* a = arena.alloc(100);
+    void* b = arena.alloc(64);
+    void* c = arena.alloc(1000);
+    assert(arena.blockSize(a) == 128 && arena.blockSize(b) == 64);
+    assert(arena.blockSize(c) == 1024);
+    std::memset(a, 0xa, 100);
+    std::memset(c, 0xc, 1000);
+    arena.print();
+
+    arena.free(b);
+    arena.free(a);
+    arena.free(c);
+    assert(arena.alloc(1 << 12) != nullptr);
+    std::cout << "alloc/free by pointer passed\n";
+  }
+
+  std::cout << "\n## ARENA ALIGNMENT ##\n";
+  {
+    // blocks above a page are only aligned if the arena itself is
+    for (bool useMmap : {false, true}) {
+      for (int i = 0; i < 16; i++) {
+        BuddyArena<1 << 20, 64> arena(useMmap);
+        for (size_t alignment : {8192, 65536, 1 << 19}) {
+          void* ptr = arena.alloc(alignment, alignment);
+          assert(ptr && reinterpret_cast<uintptr_t>(ptr) % alignment == 0);
+          std::memset(ptr, 0x5a, alignment);
+        }
+        assert(reinterpret_cast<uintptr_t>(arena.data()) % (1 << 20) == 0);
+      }
+    }
+    std::cout << "blocks above a page are aligned to their size\n";
+  }
+
+  std::cout << "\n## PMR ##\n";
+  {
+    BuddyArena<1 << 20, 16> arena;
+    BuddyMemoryResource resource(arena);
+    {
+      std::pmr::vector<int> vec(&resource);
+      for (int i = 0; i < 10000; i++) {
+        vec.push_back(i);
+      }
+      assert(arena.owns(vec.data()) && vec[9999] == 9999);
+    }
+    assert(arena.alloc(1 << 20) != nullptr);
+    std::cout << "pmr vector on buddy arena passed\n";
+  }
+
+  std::cout << "\n## SLAB ##\n";
+  {
+    using Slab = SlabAllocator<1 << 20>;
+    Slab slab;
+    assert(Slab::classSize(40) == 48 && Slab::classSize(600) == 640);
+    assert(Slab::classSize(4096) == 0);
+
+    std::vector<void*> small;
+    for (int i = 0; i < 1000; i++) {
+      void* ptr = slab.alloc(40);
+      assert(reinterpret_cast<uintptr_t>(ptr) % 16 == 0);
+      memset(ptr, i, 40);
+      small.push_back(ptr);
+    }
+    void* aligned = slab.alloc(100, 64);
+    void* large = slab.alloc(10000);
+    assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0 && large);
+    slab.print();
+
+    for (void* ptr : small) {
+      slab.free(ptr);
+    }
+    slab.free(aligned);
+    slab.free(large);
+    // only one empty slab per class is kept, so half the arena is free again
+    void* half = slab.alloc(1 << 19);
+    assert(half != nullptr);
+    slab.free(half);
+
+    BuddyMemoryResource resource(slab);
+    {
+      std::pmr::vector<std::pmr::string> strs(&resource);
+      for (int i = 0; i < 1000; i++) {
+        strs.emplace_back(std::string(i % 100 + 20, 'a' + i % 26));
+      }
+      assert(strs[999].size() == 119 && strs[999][0] == 'a' + 999 % 26);
+    }
+    {
+      // pmr may ask for zero bytes, which must not surface as bad_alloc
+      void* empty = resource.allocate(0, 1);
+      void* other = resource.allocate(0, 1);
+      assert(empty && other && empty != other);
+      resource.deallocate(empty, 0, 1);
+      resource.deallocate(other, 0, 1);
+      assert(Slab::classSize(0) == 16);
+    }
+
+    std::vector<int, SlabNodeAllocator<int, Slab>> vec{
+        SlabNodeAllocator<int, Slab>(slab)};
+    for (int i = 0; i < 100; i++) {
+      vec.push_back(i);
+    }
+    assert(vec[99] == 99);
+    std::cout << "slab alloc/free passed\n";
+  }
+
+  std::cout << "\n## DYNAMIC ##\n";
+  {
+    // 64 GiB of 4 KiB pages, the tree takes 32 MiB on the heap
+    DynamicBuddy pool(64ULL << 30, 4096);
+    uint64_t off1 = pool.alloc(1);
+    uint64_t off2 = pool.alloc(5000);
+    uint64_t off3 = pool.alloc(32ULL << 30);
+    std::cout << "alloc 1B at " << off1 << ", 5000B at " << off2
+              << ", 32GiB at " << off3 << '\n';
+    assert(off1 == 0 && off2 == 8192 && off3 == 32ULL << 30);
+    assert(pool.alloc(32ULL << 30) == DynamicBuddy::NPOS);
+    pool.print();
+
+    pool.free(off2, 5000);
+    pool.free(off1, 1);
+    pool.free(off3, 32ULL << 30);
+    assert(pool.largestFree() == 64ULL << 30);
+    pool.print();
+  }
+
+  std::cout << "\n## BITMAP ##\n";
+  {
+    BitmapBuddy bitmap(1 << 20, 64);
+    std::vector<bool> used(1 << 14);
+    std::vector<std::pair<uint64_t, uint64_t>> live;
+    for (int i = 0; i < 50000; i++) {
+      if (i % 3 != 2 || live.empty()) {
+        uint64_t size = 1 + (i * 2654435761u) % 3000;
+        uint64_t offset = bitmap.alloc(size);
+        if (offset == BitmapBuddy::NPOS) {
+          continue;
+        }
+        assert(offset % std::bit_ceil((size + 63) / 64 * 64) == 0);
+        for (uint64_t unit = offset / 64; unit < (offset + size + 63) / 64;
+             unit++) {
+          assert(!used[unit]);
+          used[unit] = true;
+        }
+        live.emplace_back(offset, size);
+      } else {
+        size_t victim = (i * 40503u) % live.size();
+        auto [offset, size] = live[victim];
+        live.erase(live.begin() + victim);
+        bitmap.free(offset, size);
+        for (uint64_t unit = offset / 64; unit < (offset + size + 63) / 64;
+             unit++) {
+          used[unit] = false;
+        }
+      }
+    }
+    for (auto [offset, size] : live) {
+      bitmap.free(offset, size);
+    }
+    assert(bitmap.largestFree() == 1 << 20);
+
+    // a free of twice the size over a split block must not free its buddy
+    uint64_t unit = bitmap.alloc(64);
+    bool threw = false;
+    try {
+      bitmap.free(unit, 128);
+    } catch (const std::string&) {
+      threw = true;
+    }
+    assert(threw && unit == 0 && bitmap.alloc(64) == 64);
+    bitmap.free(64, 64);
+    bitmap.free(unit, 64);
+    assert(bitmap.largestFree() == 1 << 20);
+    std::cout << "bitmap buddy alloc/free/coalesce passed\n";
+  }
+
+  std::cout << "\n## CONCURRENT ##\n";
+  {
+    ConcurrentBuddy pool(1 << 24, 64, 4);
+    // the thread owning each 64 B unit, so a block handed to two threads at
+    // once is caught as soon as the second one claims it
+    std::vector<std::atomic<uint8_t>> owner((1 << 24) / 64);
+    auto blockBytes = [](uint64_t size) {
+      return std::max<uint64_t>(std::bit_ceil(size), 64);
+    };
+    auto claim = [&](uint64_t offset, uint64_t size, uint8_t thread) {
+      for (uint64_t unit = offset / 64; unit < (offset + blockBytes(size)) / 64;
+           unit++) {
+        assert(owner[unit].exchange(thread) == 0);
+      }
+    };
+    auto release = [&](uint64_t offset, uint64_t size) {
+      for (uint64_t unit = offset / 64; unit < (offset + blockBytes(size)) / 64;
+           unit++) {
+        owner[unit].store(0);
+      }
+      pool.free(offset, size);
+    };
+
+    // what every thread still holds when it finishes
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> held(4);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+      workers.emplace_back([&, t]() {
+        std::vector<std::pair<uint64_t, uint64_t>>& blocks = held[t];
+        for (int i = 0; i < 20000; i++) {
+          uint64_t size = 1 + (i * 7 + t) % 2000;
+          uint64_t offset = pool.alloc(size);
+          assert(offset != ConcurrentBuddy::NPOS);
+          claim(offset, size, t + 1);
+          blocks.emplace_back(offset, size);
+          if (i % 3 == 0) {
+            release(blocks.front().first, blocks.front().second);
+            blocks.erase(blocks.begin());
+          }
+          if (blocks.size() > 64 && i < 19000) {
+            for (auto [off, sz] : blocks) release(off, sz);
+            blocks.clear();
+          }
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    // every block still held is live at once, so no two may intersect
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    for (const auto& blocks : held) {
+      for (auto [offset, size] : blocks) {
+        ranges.emplace_back(offset, offset + blockBytes(size));
+      }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 1; i < ranges.size(); i++) {
+      assert(ranges[i - 1].second <= ranges[i].first);
+    }
+    std::cout << ranges.size() << " live blocks, none overlapping\n";
+    for (const auto& blocks : held) {
+      for (auto [offset, size] : blocks) {
+        release(offset, size);
+      }
+    }
+    pool.drain();
+    assert(pool.alloc(1 << 24) == 0);
+    std::cout << "concurrent alloc/free passed\n";
+  }
+
+  std::cout << "\n## CONCURRENT FREE CHECKS ##\n";
+  {
+    ConcurrentBuddy pool(1 << 20, 64, 2);
+    auto rejects = [&pool](uint64_t offset, uint64_t size) {
+      try {
+        pool.free(offset, size);
+      } catch (const std::string&) {
+        return true;
+      }
+      return false;
+    };
+    uint64_t small = pool.alloc(64);
+    uint64_t pair = pool.alloc(128);
+    pool.free(small, 64);
+    assert(rejects(small, 64));       // double free of a cached order
+    assert(rejects(1 << 20, 64));     // past the end
+    assert(rejects(pair + 32, 64));   // not on a minimum block
+    assert(rejects(pair + 64, 128));  // not aligned to its order
+    assert(rejects(pair, 64));        // not the size it was allocated with
+    pool.free(pair, 128);
+    uint64_t large = pool.alloc(64 << 10);
+    pool.free(large, 64 << 10);
+    assert(rejects(large, 64 << 10));
+    // the rejected frees never reached a cache, so no block comes out twice
+    assert(pool.alloc(64) != pool.alloc(64));
+    std::cout << "invalid and double frees rejected\n";
+  }
+
   return 0;
 }
\ No newline at end of file
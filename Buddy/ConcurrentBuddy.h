@@ -0,0 +1,297 @@
+#pragma once
+
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DynamicBuddy.h"
+
+/**
+ * Thread-safe buddy allocator. The arena is striped into power-of-two regions,
+ * one per shard, each a DynamicBuddy behind its own mutex: a thread starts in
+ * the region of its CPU and only moves on when that one cannot serve it, so
+ * threads on different CPUs take different locks. A block larger than a
+ * region takes every region lock, in order, and claims a run of wholly free
+ * regions. Small blocks (orders below CACHED_ORDERS) are served from per-CPU
+ * caches that are refilled from, and flushed back to, the regions in batches.
+ */
+class ConcurrentBuddy {
+  static constexpr uint32_t CACHED_ORDERS = 4;
+  static constexpr size_t CACHE_CAPACITY = 64;
+  static constexpr size_t REFILL_BATCH = 16;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::vector<uint64_t> blocks[CACHED_ORDERS];
+  };
+
+  struct alignas(64) Region {
+    Region(uint64_t size, uint64_t minBlock) : buddy(size, minBlock) {}
+
+    std::mutex mutex;
+    DynamicBuddy buddy;
+  };
+
+ public:
+  static constexpr uint64_t NPOS = DynamicBuddy::NPOS;
+
+  explicit ConcurrentBuddy(uint64_t size, uint64_t minBlock = 4096,
+                           size_t shards = std::thread::hardware_concurrency())
+      : shardCount_(std::max<size_t>(shards, 1)),
+        shards_(std::make_unique<Shard[]>(shardCount_)) {
+    if (!std::has_single_bit(size) || !std::has_single_bit(minBlock) ||
+        minBlock > size) {
+      throw "Buddy size and minimum block size must be powers of 2";
+    }
+    // a region still holds a few refill batches of the largest cached order
+    regionCount_ = std::min<uint64_t>(
+        std::bit_ceil(shardCount_),
+        std::max<uint64_t>(size / (minBlock << (CACHED_ORDERS + 5)), 1));
+    regionSize_ = size / regionCount_;
+    minBlockShift_ = std::countr_zero(minBlock);
+    for (size_t i = 0; i < regionCount_; i++) {
+      regions_.push_back(std::make_unique<Region>(regionSize_, minBlock));
+    }
+    handedOut_ =
+        std::make_unique<std::atomic<uint8_t>[]>(size >> minBlockShift_);
+  }
+  ~ConcurrentBuddy() = default;
+
+  ConcurrentBuddy(const ConcurrentBuddy&) = delete;
+  ConcurrentBuddy& operator=(const ConcurrentBuddy&) = delete;
+
+  /**
+   * @brief Allocate a block of at least size bytes and return its offset, or
+   * NPOS if no free block is large enough
+   *
+   * @param[in] size
+   * @return uint64_t
+   */
+  uint64_t alloc(uint64_t size) {
+    if (size == 0 || size > capacity()) {
+      return NPOS;
+    }
+
+    const uint32_t order = orderOf(size);
+    uint64_t offset;
+    if (order >= CACHED_ORDERS) {
+      offset = allocShared(size);
+      if (offset == NPOS) {
+        // small blocks parked in caches may be what prevents coalescing
+        drain();
+        offset = allocShared(size);
+      }
+    } else {
+      offset = allocCached(order);
+      if (offset == NPOS) {
+        drain();
+        offset = allocCached(order);
+      }
+    }
+    if (offset != NPOS) {
+      handedOut_[offset >> minBlockShift_].store(encode(order),
+                                                 std::memory_order_relaxed);
+    }
+    return offset;
+  }
+
+  /**
+   * @brief Free the block of size bytes allocated at offset
+   *
+   * @param[in] offset
+   * @param[in] size
+   */
+  void free(uint64_t offset, uint64_t size) {
+    if (size == 0 || size > capacity() || offset >= capacity() ||
+        (offset & (minBlock() - 1))) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    const uint32_t order = orderOf(size);
+    const uint64_t unitOffset = offset >> minBlockShift_;
+    if (unitOffset & ((1ULL << order) - 1)) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    // a cache would hand a bad block out again, so only take back what alloc
+    // gave out, with the same order, and only once
+    uint8_t expected = encode(order);
+    if (!handedOut_[unitOffset].compare_exchange_strong(
+            expected, 0, std::memory_order_relaxed)) {
+      throw "Double Free at offset " + std::to_string(offset);
+    }
+
+    if (order >= CACHED_ORDERS) {
+      freeShared(offset, size);
+      return;
+    }
+
+    Shard& shard = shards_[localIndex() % shardCount_];
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    std::vector<uint64_t>& cache = shard.blocks[order];
+    cache.push_back(offset);
+    if (cache.size() > CACHE_CAPACITY) {
+      // give the older half back so the regions can coalesce it
+      const uint64_t blockSize = minBlock() << order;
+      for (size_t i = 0; i < CACHE_CAPACITY / 2; i++) {
+        freeShared(cache[i], blockSize);
+      }
+      cache.erase(cache.begin(), cache.begin() + CACHE_CAPACITY / 2);
+    }
+  }
+
+  /**
+   * @brief Return every cached block to its region
+   *
+   */
+  void drain() {
+    for (size_t i = 0; i < shardCount_; i++) {
+      Shard& shard = shards_[i];
+      std::lock_guard<std::mutex> shardLock(shard.mutex);
+      for (uint32_t order = 0; order < CACHED_ORDERS; order++) {
+        for (uint64_t offset : shard.blocks[order]) {
+          freeShared(offset, minBlock() << order);
+        }
+        shard.blocks[order].clear();
+      }
+    }
+  }
+
+  inline uint64_t capacity() const { return regionSize_ * regionCount_; }
+
+  inline uint64_t minBlock() const { return regions_[0]->buddy.minBlock(); }
+
+  inline size_t regions() const { return regionCount_; }
+
+ private:
+  // handedOut_ holds order + 1 of an allocated block at its first unit
+  static inline uint8_t encode(uint32_t order) { return order + 1; }
+
+  inline uint32_t orderOf(uint64_t size) const {
+    return regions_[0]->buddy.orderOf(size);
+  }
+
+  static size_t localIndex() {
+    int cpu = sched_getcpu();
+    return cpu >= 0 ? static_cast<size_t>(cpu)
+                    : std::hash<std::thread::id>()(std::this_thread::get_id());
+  }
+
+  /**
+   * @brief Allocate from the regions, starting with the local one
+   *
+   * @param[in] size
+   * @return uint64_t
+   */
+  uint64_t allocShared(uint64_t size) {
+    if (size > regionSize_) {
+      return allocSpan(size);
+    }
+    const size_t home = localIndex();
+    for (size_t i = 0; i < regionCount_; i++) {
+      const size_t index = (home + i) & (regionCount_ - 1);
+      Region& region = *regions_[index];
+      std::lock_guard<std::mutex> lock(region.mutex);
+      if (uint64_t offset = region.buddy.alloc(size); offset != NPOS) {
+        return index * regionSize_ + offset;
+      }
+    }
+    return NPOS;
+  }
+
+  /**
+   * @brief Allocate a block larger than a region as an aligned run of wholly
+   * free regions, holding every region lock
+   *
+   * @param[in] size
+   * @return uint64_t
+   */
+  uint64_t allocSpan(uint64_t size) {
+    const size_t span = std::bit_ceil(size) / regionSize_;
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(regionCount_);
+    for (size_t i = 0; i < regionCount_; i++) {
+      locks.emplace_back(regions_[i]->mutex);
+    }
+    for (size_t first = 0; first < regionCount_; first += span) {
+      bool free = true;
+      for (size_t i = first; i < first + span && free; i++) {
+        free = regions_[i]->buddy.largestFree() == regionSize_;
+      }
+      if (free) {
+        for (size_t i = first; i < first + span; i++) {
+          regions_[i]->buddy.alloc(regionSize_);
+        }
+        return first * regionSize_;
+      }
+    }
+    return NPOS;
+  }
+
+  void freeShared(uint64_t offset, uint64_t size) {
+    const size_t first = offset / regionSize_;
+    if (size <= regionSize_) {
+      Region& region = *regions_[first];
+      std::lock_guard<std::mutex> lock(region.mutex);
+      region.buddy.free(offset & (regionSize_ - 1), size);
+      return;
+    }
+    const size_t span = std::bit_ceil(size) / regionSize_;
+    for (size_t i = first; i < first + span; i++) {
+      std::lock_guard<std::mutex> lock(regions_[i]->mutex);
+      regions_[i]->buddy.free(0, regionSize_);
+    }
+  }
+
+  /**
+   * @brief Pop a block from the local cache, refilling it with a batch from
+   * the first region that has any
+   *
+   * @param[in] order
+   * @return uint64_t
+   */
+  uint64_t allocCached(uint32_t order) {
+    const size_t home = localIndex();
+    Shard& shard = shards_[home % shardCount_];
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    std::vector<uint64_t>& cache = shard.blocks[order];
+    const uint64_t blockSize = minBlock() << order;
+    for (size_t i = 0; i < regionCount_ && cache.empty(); i++) {
+      const size_t index = (home + i) & (regionCount_ - 1);
+      Region& region = *regions_[index];
+      std::lock_guard<std::mutex> lock(region.mutex);
+      for (size_t j = 0; j < REFILL_BATCH; j++) {
+        uint64_t offset = region.buddy.alloc(blockSize);
+        if (offset == NPOS) {
+          break;
+        }
+        cache.push_back(index * regionSize_ + offset);
+      }
+    }
+    if (cache.empty()) {
+      return NPOS;
+    }
+
+    uint64_t offset = cache.back();
+    cache.pop_back();
+    return offset;
+  }
+
+ private:
+  size_t shardCount_;
+  std::unique_ptr<Shard[]> shards_;
+
+  // region locks are taken after a shard lock, and in index order
+  size_t regionCount_;
+  uint64_t regionSize_;
+  uint32_t minBlockShift_;
+  std::vector<std::unique_ptr<Region>> regions_;
+  std::unique_ptr<std::atomic<uint8_t>[]> handedOut_;
+};
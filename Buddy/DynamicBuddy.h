@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/**
+ * Runtime-sized counterpart of Buddy. The arena size is only known at
+ * construction and is managed in units of minBlock bytes (e.g. 4 KiB pages),
+ * so the longest_ tree has 2 * size / minBlock entries and lives on the heap.
+ * Offsets and sizes are in bytes and 64-bit wide.
+ */
+class DynamicBuddy {
+ public:
+  static constexpr uint64_t NPOS = UINT64_MAX;
+
+  explicit DynamicBuddy(uint64_t size, uint64_t minBlock = 4096)
+      : minBlock_(minBlock),
+        minBlockShift_(std::countr_zero(minBlock)),
+        maxOrder_(0) {
+    if (!std::has_single_bit(size) || !std::has_single_bit(minBlock) ||
+        minBlock > size) {
+      throw "Buddy size and minimum block size must be powers of 2";
+    }
+
+    maxOrder_ = std::countr_zero(size >> minBlockShift_);
+    longest_ = std::make_unique<uint8_t[]>(size_t(2) << maxOrder_);
+    for (uint32_t depth = 0; depth <= maxOrder_; depth++) {
+      std::fill(longest_.get() + (size_t(1) << depth),
+                longest_.get() + (size_t(2) << depth),
+                encode(maxOrder_ - depth));
+    }
+  }
+  ~DynamicBuddy() = default;
+
+  DynamicBuddy(const DynamicBuddy&) = delete;
+  DynamicBuddy& operator=(const DynamicBuddy&) = delete;
+  DynamicBuddy(DynamicBuddy&&) = default;
+  DynamicBuddy& operator=(DynamicBuddy&&) = default;
+
+  /**
+   * @brief Allocate a block of at least size bytes and return its offset, or
+   * NPOS if no free block is large enough
+   *
+   * @param[in] size
+   * @return uint64_t
+   */
+  uint64_t alloc(uint64_t size) {
+    if (size == 0 || size > capacity()) {
+      return NPOS;
+    }
+
+    const uint32_t order = orderOf(size);
+    if (longest_[ROOT] < encode(order)) {
+      return NPOS;
+    }
+
+    size_t index = ROOT;
+    for (uint32_t curOrder = maxOrder_; curOrder > order; curOrder--) {
+      index = longest_[leftChild(index)] >= encode(order) ? leftChild(index)
+                                                          : rightChild(index);
+    }
+
+    longest_[index] = 0;
+    uint64_t offset = (index - (size_t(1) << (maxOrder_ - order))) << order;
+    updateAncestors(index, order);
+    return offset << minBlockShift_;
+  }
+
+  /**
+   * @brief Free the block of size bytes allocated at offset
+   *
+   * @param[in] offset
+   * @param[in] size
+   */
+  void free(uint64_t offset, uint64_t size) {
+    if (size == 0 || size > capacity() || offset >= capacity() ||
+        (offset & (minBlock_ - 1))) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+    const uint32_t order = orderOf(size);
+    const uint64_t unitOffset = offset >> minBlockShift_;
+    if (unitOffset & ((1ULL << order) - 1)) {
+      throw "Invalid size free at offset " + std::to_string(offset);
+    }
+
+    size_t index = (size_t(1) << (maxOrder_ - order)) + (unitOffset >> order);
+    if (longest_[index] != 0) {
+      throw "Double Free at offset " + std::to_string(offset);
+    }
+    longest_[index] = encode(order);
+    updateAncestors(index, order);
+  }
+
+  inline uint64_t capacity() const { return minBlock_ << maxOrder_; }
+
+  inline uint64_t minBlock() const { return minBlock_; }
+
+  /**
+   * @brief Return log2 of the number of minimum blocks used to serve size bytes
+   *
+   * @param[in] size
+   * @return uint32_t
+   */
+  inline uint32_t orderOf(uint64_t size) const {
+    uint64_t units = (size + minBlock_ - 1) >> minBlockShift_;
+    return std::bit_width(units - 1);
+  }
+
+  /**
+   * @brief Return the size of the largest block that can still be allocated
+   *
+   * @return uint64_t
+   */
+  inline uint64_t largestFree() const {
+    return longest_[ROOT] ? minBlock_ << (longest_[ROOT] - 1) : 0;
+  }
+
+  /* Only for debug */
+  void print() const {
+    std::cout << "Capacity: " << capacity() << ", min block: " << minBlock_
+              << ", largest free block: " << largestFree() << '\n';
+  }
+
+ private:
+  // longest_ holds order + 1 of the largest free block below a node, 0 for none
+  static inline uint8_t encode(uint32_t order) { return order + 1; }
+
+  static inline size_t leftChild(size_t index) { return index << 1; }
+
+  static inline size_t rightChild(size_t index) { return (index << 1) + 1; }
+
+  static inline size_t parent(size_t index) { return index >> 1; }
+
+  /**
+   * @brief Recompute longest_ from index (a node of the given order) up to the
+   * root, merging two fully free buddies into their parent
+   *
+   * @param[in] index
+   * @param[in] order
+   */
+  void updateAncestors(size_t index, uint32_t order) {
+    while (index != ROOT) {
+      index = parent(index);
+      uint8_t left = longest_[leftChild(index)];
+      uint8_t right = longest_[rightChild(index)];
+      longest_[index] = (left == encode(order) && right == encode(order))
+                            ? encode(order + 1)
+                            : std::max(left, right);
+      order++;
+    }
+  }
+
+ private:
+  static constexpr size_t ROOT = 1;
+
+  uint64_t minBlock_;
+  uint32_t minBlockShift_;
+  uint32_t maxOrder_;
+  std::unique_ptr<uint8_t[]> longest_;
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <new>
+
+#include "BuddyArena.h"
+
+/**
+ * Size-class allocator layered on a BuddyArena, in the spirit of a kernel
+ * slab allocator. Requests up to 2 KiB are rounded to one of a few size
+ * classes (16 B steps up to 128 B, then four classes per power of 2) instead
+ * of a power of 2, and served from slabs: buddy blocks of one or more pages
+ * cut into equal objects with an intrusive free list. A slab is handed back
+ * to the buddy once it runs empty, except for one empty slab kept per class
+ * so that alloc/free around a slab boundary does not thrash the buddy.
+ * Larger requests go to the buddy directly.
+ */
+template <int Size, int PageSize = 4096>
+class SlabAllocator {
+  static constexpr uint32_t PAGES = Size / PageSize;
+  static constexpr size_t SIZE_CLASSES[] = {
+      16,  32,  48,  64,  80,  96,  112,  128,  160,  192,  224,  256,
+      320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048};
+  static constexpr uint32_t CLASSES = std::size(SIZE_CLASSES);
+  static constexpr size_t MAX_SMALL = SIZE_CLASSES[CLASSES - 1];
+  // a slab spans as many pages as needed to hold this many objects
+  static constexpr size_t MIN_OBJECTS = 8;
+  static_assert(PageSize >= 64 && Size >= 2 * MAX_SMALL * MIN_OBJECTS);
+
+  // CLASS_OF[(size + 15) / 16] is the smallest class that fits size bytes
+  static constexpr auto CLASS_OF = [] {
+    std::array<uint8_t, MAX_SMALL / 16 + 1> res{};
+    uint8_t cls = 0;
+    for (size_t i = 1; i < res.size(); i++) {
+      while (SIZE_CLASSES[cls] < i * 16) {
+        cls++;
+      }
+      res[i] = cls;
+    }
+    return res;
+  }();
+
+  struct FreeObject {
+    FreeObject* next;
+  };
+
+  // lives at the start of every slab
+  struct SlabHeader {
+    FreeObject* freeList;
+    SlabHeader* prev;
+    SlabHeader* next;
+    uint32_t inUse;
+  };
+
+  struct SizeClass {
+    // slabs with at least one free object, empty ones included
+    SlabHeader* partial;
+    uint32_t emptySlabs;
+    uint32_t slabs;
+    size_t objects;
+    size_t slabBytes;
+    size_t firstObject;
+    uint32_t capacity;
+  };
+
+ public:
+  explicit SlabAllocator(bool useMmap = false)
+      : arena_(useMmap), pageClass_{} {
+    for (uint32_t cls = 0; cls < CLASSES; cls++) {
+      const size_t objSize = SIZE_CLASSES[cls];
+      SizeClass& sc = classes_[cls];
+      sc.partial = nullptr;
+      sc.emptySlabs = 0;
+      sc.slabs = 0;
+      sc.objects = 0;
+      sc.slabBytes = std::max<size_t>(PageSize,
+                                      std::bit_ceil(objSize * MIN_OBJECTS));
+      // objects are aligned to the largest power of 2 dividing their size
+      const size_t align = objSize & -objSize;
+      sc.firstObject = (sizeof(SlabHeader) + align - 1) & ~(align - 1);
+      sc.capacity = (sc.slabBytes - sc.firstObject) / objSize;
+    }
+  }
+  ~SlabAllocator() = default;
+
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+  SlabAllocator(SlabAllocator&&) = delete;
+  SlabAllocator& operator=(SlabAllocator&&) = delete;
+
+  /**
+   * @brief Allocate size bytes aligned to alignment. Return nullptr if the
+   * arena is exhausted. A size of 0 still gets a distinct block of the
+   * smallest class, as std::pmr expects.
+   *
+   * @param[in] size
+   * @param[in] alignment a power of 2
+   * @return void*
+   */
+  void* alloc(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    if (size <= MAX_SMALL && alignment <= MAX_SMALL) {
+      uint32_t cls = CLASS_OF[(size + 15) / 16];
+      while (cls < CLASSES &&
+             (SIZE_CLASSES[cls] & -SIZE_CLASSES[cls]) < alignment) {
+        cls++;
+      }
+      if (cls < CLASSES) {
+        return allocSmall(cls);
+      }
+    }
+    return arena_.alloc(size, alignment);
+  }
+
+  /**
+   * @brief Free a pointer returned by alloc
+   *
+   * @param[in] ptr
+   */
+  void free(void* ptr) {
+    if (ptr == nullptr) {
+      return;
+    }
+    if (!arena_.owns(ptr)) {
+      throw "Free of a pointer not owned by the slab allocator";
+    }
+
+    const size_t offset = static_cast<char*>(ptr) - arena_.data();
+    const uint8_t tag = pageClass_[offset / PageSize];
+    if (tag == 0) {
+      arena_.free(ptr);
+      return;
+    }
+
+    const uint32_t cls = tag - 1;
+    SizeClass& sc = classes_[cls];
+    SlabHeader* slab = reinterpret_cast<SlabHeader*>(
+        arena_.data() + (offset & ~(sc.slabBytes - 1)));
+    if (slab->freeList == nullptr) {
+      pushPartial(sc, slab);
+    }
+    FreeObject* obj = static_cast<FreeObject*>(ptr);
+    obj->next = slab->freeList;
+    slab->freeList = obj;
+    sc.objects--;
+
+    if (--slab->inUse == 0) {
+      if (sc.emptySlabs > 0) {
+        unlinkPartial(sc, slab);
+        releaseSlab(sc, slab);
+      } else {
+        sc.emptySlabs++;
+      }
+    }
+  }
+
+  /**
+   * @brief Return the size class a request of size bytes is served from, or
+   * 0 if it goes to the buddy directly
+   *
+   * @param[in] size
+   * @return size_t
+   */
+  static inline size_t classSize(size_t size) {
+    if (size > MAX_SMALL) {
+      return 0;
+    }
+    return SIZE_CLASSES[CLASS_OF[(size + 15) / 16]];
+  }
+
+  inline size_t capacity() const { return Size; }
+
+  /* Only for debug */
+  void print() const {
+    for (uint32_t cls = 0; cls < CLASSES; cls++) {
+      const SizeClass& sc = classes_[cls];
+      if (sc.slabs == 0) {
+        continue;
+      }
+      std::cout << "class " << SIZE_CLASSES[cls] << "B: " << sc.slabs
+                << " slabs of " << sc.slabBytes << "B, " << sc.objects << '/'
+                << sc.slabs * sc.capacity << " objects in use\n";
+    }
+  }
+
+ private:
+  void* allocSmall(uint32_t cls) {
+    SizeClass& sc = classes_[cls];
+    SlabHeader* slab = sc.partial;
+    if (slab == nullptr) {
+      slab = createSlab(cls);
+      if (slab == nullptr) {
+        return nullptr;
+      }
+    }
+    if (slab->inUse++ == 0) {
+      sc.emptySlabs--;
+    }
+
+    FreeObject* obj = slab->freeList;
+    slab->freeList = obj->next;
+    if (slab->freeList == nullptr) {
+      unlinkPartial(sc, slab);
+    }
+    sc.objects++;
+    return obj;
+  }
+
+  /**
+   * @brief Take a slab from the buddy, cut it into objects and make it the
+   * first partial slab of its class
+   *
+   * @param[in] cls
+   * @return SlabHeader*
+   */
+  SlabHeader* createSlab(uint32_t cls) {
+    SizeClass& sc = classes_[cls];
+    char* base = static_cast<char*>(arena_.alloc(sc.slabBytes));
+    if (base == nullptr) {
+      return nullptr;
+    }
+
+    SlabHeader* slab = new (base) SlabHeader{nullptr, nullptr, nullptr, 0};
+    // thread the free list in address order
+    for (uint32_t i = sc.capacity; i > 0; i--) {
+      FreeObject* obj = reinterpret_cast<FreeObject*>(
+          base + sc.firstObject + (i - 1) * SIZE_CLASSES[cls]);
+      obj->next = slab->freeList;
+      slab->freeList = obj;
+    }
+
+    const size_t page = (base - arena_.data()) / PageSize;
+    std::fill_n(pageClass_ + page, sc.slabBytes / PageSize, cls + 1);
+    pushPartial(sc, slab);
+    sc.emptySlabs++;
+    sc.slabs++;
+    return slab;
+  }
+
+  void releaseSlab(SizeClass& sc, SlabHeader* slab) {
+    char* base = reinterpret_cast<char*>(slab);
+    const size_t page = (base - arena_.data()) / PageSize;
+    std::fill_n(pageClass_ + page, sc.slabBytes / PageSize, 0);
+    sc.slabs--;
+    arena_.free(base);
+  }
+
+  static void pushPartial(SizeClass& sc, SlabHeader* slab) {
+    slab->prev = nullptr;
+    slab->next = sc.partial;
+    if (sc.partial) {
+      sc.partial->prev = slab;
+    }
+    sc.partial = slab;
+  }
+
+  static void unlinkPartial(SizeClass& sc, SlabHeader* slab) {
+    if (slab->prev) {
+      slab->prev->next = slab->next;
+    } else {
+      sc.partial = slab->next;
+    }
+    if (slab->next) {
+      slab->next->prev = slab->prev;
+    }
+  }
+
+ private:
+  BuddyArena<Size, PageSize> arena_;
+  SizeClass classes_[CLASSES];
+  // class + 1 of the slab a page belongs to, 0 for pages not in a slab
+  uint8_t pageClass_[PAGES];
+};
+
+/**
+ * Standard allocator drawing from a SlabAllocator (or any type with
+ * alloc(size, alignment) and free(ptr)), meant as the node allocator of the
+ * containers in this repo. Copies and rebinds share the same slab allocator.
+ */
+template <class T, class Slab>
+class SlabNodeAllocator {
+  template <class U, class S>
+  friend class SlabNodeAllocator;
+
+ public:
+  using value_type = T;
+
+  explicit SlabNodeAllocator(Slab& slab) : slab_(&slab) {}
+  template <class U>
+  SlabNodeAllocator(const SlabNodeAllocator<U, Slab>& other)
+      : slab_(other.slab_) {}
+
+  T* allocate(size_t n) {
+    void* ptr = slab_->alloc(n * sizeof(T), alignof(T));
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T* ptr, size_t) { slab_->free(ptr); }
+
+  template <class U>
+  bool operator==(const SlabNodeAllocator<U, Slab>& other) const {
+    return slab_ == other.slab_;
+  }
+  template <class U>
+  bool operator!=(const SlabNodeAllocator<U, Slab>& other) const {
+    return slab_ != other.slab_;
+  }
+
+ private:
+  Slab* slab_;
+};
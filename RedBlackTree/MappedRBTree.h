@@ -0,0 +1,295 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "RBTree.h"
+
+/**
+ * Read-only, zero-copy view of an RBTree saved to disk. The file holds a
+ * header, then every key in order, then the values in the same order, each
+ * array aligned to 64 bytes, so the view is just an mmap of the file: lookups
+ * binary search the key array in place and nothing is read before it is
+ * touched. A mutable tree is rebuilt from the view in O(n) with
+ * RBTree::buildFromSorted(view.begin(), view.end()), without any rebalancing.
+ * Keys and values must be trivially copyable, and files are only read back on
+ * machines with the same endianness.
+ */
+template <class Key, class Value, class Compare = comp<Key>>
+class MappedRBTree {
+  static_assert(std::is_trivially_copyable_v<Key> &&
+                std::is_trivially_copyable_v<Value>);
+  static constexpr char MAGIC[8] = {'R', 'B', 'T', 'R', 'E', 'E', '0', '1'};
+  static constexpr uint64_t ALIGNMENT = 64;
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint64_t count;
+    uint64_t keysOffset;
+    uint64_t valuesOffset;
+  };
+
+ public:
+  /**
+   * Random access iterator over the entries, in key order
+   */
+  class MappedIterator {
+    friend class MappedRBTree;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::pair<Key, Value>;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::pair<const Key &, const Value &>;
+    struct pointer {
+      reference ref;
+      reference *operator->() { return &ref; }
+    };
+
+    MappedIterator() : view_(nullptr), index_(0) {}
+
+    bool operator==(const MappedIterator &other) const {
+      return index_ == other.index_;
+    }
+    auto operator<=>(const MappedIterator &other) const {
+      return index_ <=> other.index_;
+    }
+
+    pointer operator->() const { return pointer{**this}; }
+    reference operator*() const {
+      return {view_->keys_[index_], view_->values_[index_]};
+    }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    MappedIterator &operator++() {
+      index_++;
+      return *this;
+    }
+    MappedIterator operator++(int) {
+      MappedIterator tmp = *this;
+      index_++;
+      return tmp;
+    }
+    MappedIterator &operator--() {
+      index_--;
+      return *this;
+    }
+    MappedIterator operator--(int) {
+      MappedIterator tmp = *this;
+      index_--;
+      return tmp;
+    }
+
+    MappedIterator &operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    MappedIterator &operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+    MappedIterator operator+(difference_type n) const {
+      return MappedIterator(view_, index_ + n);
+    }
+    MappedIterator operator-(difference_type n) const {
+      return MappedIterator(view_, index_ - n);
+    }
+    friend MappedIterator operator+(difference_type n,
+                                    const MappedIterator &iter) {
+      return iter + n;
+    }
+    difference_type operator-(const MappedIterator &other) const {
+      return static_cast<difference_type>(index_) -
+             static_cast<difference_type>(other.index_);
+    }
+
+   private:
+    MappedIterator(const MappedRBTree *view, size_t index)
+        : view_(view), index_(index) {}
+
+   private:
+    const MappedRBTree *view_;
+    size_t index_;
+  };
+
+  using iterator = MappedIterator;
+  using const_iterator = MappedIterator;
+
+ public:
+  /**
+   * @brief Map a file written by save
+   *
+   * @param[in] path
+   */
+  explicit MappedRBTree(const std::string &path,
+                        const Compare &compareFunc = Compare())
+      : compareFunc_(compareFunc),
+        data_(nullptr),
+        length_(0),
+        keys_(nullptr),
+        values_(nullptr),
+        size_(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw "Cannot open " + path;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+      close(fd);
+      throw "Not an RBTree file: " + path;
+    }
+    length_ = st.st_size;
+    void *ptr = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw "Cannot map " + path;
+    }
+    data_ = static_cast<const char *>(ptr);
+
+    FileHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.keySize != sizeof(Key) || header.valueSize != sizeof(Value) ||
+        header.keysOffset % ALIGNMENT || header.valuesOffset % ALIGNMENT ||
+        header.keysOffset < sizeof(FileHeader) ||
+        header.keysOffset > length_ || header.valuesOffset > length_ ||
+        header.count > (length_ - header.keysOffset) / sizeof(Key) ||
+        header.keysOffset + header.count * sizeof(Key) > header.valuesOffset ||
+        header.count > (length_ - header.valuesOffset) / sizeof(Value)) {
+      munmap(const_cast<char *>(data_), length_);
+      throw "Not an RBTree file of this key and value type: " + path;
+    }
+    keys_ = reinterpret_cast<const Key *>(data_ + header.keysOffset);
+    values_ = reinterpret_cast<const Value *>(data_ + header.valuesOffset);
+    size_ = header.count;
+  }
+  ~MappedRBTree() { munmap(const_cast<char *>(data_), length_); }
+
+  MappedRBTree(const MappedRBTree &) = delete;
+  MappedRBTree &operator=(const MappedRBTree &) = delete;
+
+  /**
+   * @brief Write the entries of tree, in key order, to path
+   *
+   * @param[in] tree an RBTree, or anything iterable in key order with size()
+   * @param[in] path
+   */
+  template <class Tree>
+  static void save(const Tree &tree, const std::string &path) {
+    FileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.keySize = sizeof(Key);
+    header.valueSize = sizeof(Value);
+    header.count = tree.size();
+    header.keysOffset = alignUp(sizeof(FileHeader));
+    header.valuesOffset =
+        alignUp(header.keysOffset + header.count * sizeof(Key));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw "Cannot create " + path;
+    }
+    const char zeros[ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(zeros, header.keysOffset - sizeof(header));
+    for (auto iter = tree.begin(); iter != tree.end(); ++iter) {
+      out.write(reinterpret_cast<const char *>(&iter->first), sizeof(Key));
+    }
+    out.write(zeros, header.valuesOffset - header.keysOffset -
+                         header.count * sizeof(Key));
+    for (auto iter = tree.begin(); iter != tree.end(); ++iter) {
+      out.write(reinterpret_cast<const char *>(&iter->second),
+                sizeof(Value));
+    }
+    if (!out.flush()) {
+      throw "Cannot write " + path;
+    }
+  }
+
+  inline size_t size() const { return size_; }
+
+  inline bool empty() const { return size_ == 0; }
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size_); }
+
+  /**
+   * @brief Get the value by specified key, return defaultValue if the key
+   * doesn't exist
+   *
+   * @param[in] key
+   * @param[in] defaultValue
+   * @return const Value&
+   */
+  const Value &get(const Key &key, const Value &defaultValue) const {
+    size_t index = lowerBoundIndex(key);
+    if (index < size_ && compareFunc_(key, keys_[index]) == 0) {
+      return values_[index];
+    }
+    return defaultValue;
+  }
+
+  /**
+   * @brief Return an iterator to the first key not smaller than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator lower_bound(const Key &key) const {
+    return iterator(this, lowerBoundIndex(key));
+  }
+
+  /**
+   * @brief Return an iterator to the first key greater than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator upper_bound(const Key &key) const {
+    size_t index = lowerBoundIndex(key);
+    if (index < size_ && compareFunc_(key, keys_[index]) == 0) {
+      index++;
+    }
+    return iterator(this, index);
+  }
+
+ private:
+  static inline uint64_t alignUp(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  size_t lowerBoundIndex(const Key &key) const {
+    size_t lo = 0;
+    size_t hi = size_;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (compareFunc_(keys_[mid], key) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+ private:
+  Compare compareFunc_;
+  const char *data_;
+  size_t length_;
+  const Key *keys_;
+  const Value *values_;
+  size_t size_;
+};
@@ -0,0 +1,639 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "RBTree.h"
+
+/**
+ * Red-black tree map for many readers and one writer at a time. Nodes are
+ * immutable once published: upsert copies the path from the root down to the
+ * key, and remove rebuilds the path around it with split / join, so every
+ * other subtree is shared with the previous version. Each write publishes the
+ * new version by storing a raw pointer to it into one std::atomic. A reader
+ * takes a Snapshot, which keeps its version alive, and walks it without any
+ * lock while writes go on. Versions and nodes are reference counted and freed,
+ * on whichever thread drops the last reference, once nothing uses them.
+ *
+ * The pointer load and the reference count increment of a reader are not one
+ * atomic step, so the writer may not drop its reference to a replaced version
+ * right away. Readers announce the epoch they start in for those few
+ * instructions, in one of READER_SLOTS slots; a replaced version is retired
+ * with the epoch it was replaced in and released once every announced epoch
+ * is later. Readers never wait for the writer, only for a free slot when more
+ * than READER_SLOTS of them are taking a snapshot at the same moment.
+ */
+template <class Key, class Value, class Compare = comp<Key>>
+class PersistentRBTree {
+  enum NodeColor : uint8_t { RED, BLACK };
+
+  static constexpr size_t READER_SLOTS = 64;
+
+  struct Node;
+  struct Version;
+
+  // owning reference to an immutable node or version, nullptr being NIL
+  template <class T>
+  class Ref {
+   public:
+    Ref() : object_(nullptr) {}
+    // adopts a reference already counted in object->refs_
+    explicit Ref(const T *object) : object_(object) {}
+    Ref(const Ref &other) : object_(other.object_) { retain(); }
+    Ref(Ref &&other) : object_(other.object_) { other.object_ = nullptr; }
+    ~Ref() { release(); }
+
+    Ref &operator=(const Ref &other) {
+      other.retain();
+      release();
+      object_ = other.object_;
+      return *this;
+    }
+    Ref &operator=(Ref &&other) {
+      if (this != &other) {
+        release();
+        object_ = other.object_;
+        other.object_ = nullptr;
+      }
+      return *this;
+    }
+
+    inline const T *get() const { return object_; }
+    inline const T *operator->() const { return object_; }
+    inline const T &operator*() const { return *object_; }
+    inline explicit operator bool() const { return object_ != nullptr; }
+
+   private:
+    inline void retain() const {
+      if (object_) {
+        object_->refs_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    inline void release() {
+      if (object_ &&
+          object_->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete object_;
+      }
+    }
+
+   private:
+    const T *object_;
+  };
+
+  using NodeRef = Ref<Node>;
+  using VersionRef = Ref<Version>;
+
+  struct Node {
+    Node(NodeColor color, NodeRef left, const Key &key, const Value &value,
+         NodeRef right)
+        : key_(key),
+          value_(value),
+          left_(std::move(left)),
+          right_(std::move(right)),
+          refs_(1),
+          color_(color),
+          blackHeight_(blackHeightOf(left_) + (color == BLACK)) {}
+
+    Key key_;
+    Value value_;
+    NodeRef left_;
+    NodeRef right_;
+    mutable std::atomic<uint32_t> refs_;
+    NodeColor color_;
+    // black nodes from here down to a leaf, this one included
+    uint8_t blackHeight_;
+  };
+
+  // a published version, immutable as well
+  struct Version {
+    Version(NodeRef root, size_t size)
+        : root_(std::move(root)), size_(size), refs_(1) {}
+
+    NodeRef root_;
+    size_t size_;
+    mutable std::atomic<uint32_t> refs_;
+  };
+
+  static_assert(std::atomic<const Version *>::is_always_lock_free);
+
+  struct alignas(64) ReaderSlot {
+    // the epoch a reader started in, 0 while the slot is free
+    std::atomic<uint64_t> epoch{0};
+  };
+
+  /**
+   * Holds a reader slot, announcing the current epoch, for as long as it
+   * lives. The version loaded meanwhile stays referenced by the tree.
+   */
+  class ReadGuard {
+   public:
+    explicit ReadGuard(const PersistentRBTree &tree) {
+      size_t index = std::hash<std::thread::id>()(std::this_thread::get_id());
+      for (size_t tries = 1;; tries++, index++) {
+        std::atomic<uint64_t> &epoch = tree.slots_[index % READER_SLOTS].epoch;
+        uint64_t idle = 0;
+        if (epoch.load(std::memory_order_relaxed) == 0 &&
+            epoch.compare_exchange_strong(idle, tree.epoch_.load())) {
+          slot_ = &epoch;
+          return;
+        }
+        if (tries % READER_SLOTS == 0) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    ~ReadGuard() { slot_->store(0, std::memory_order_release); }
+
+    ReadGuard(const ReadGuard &) = delete;
+    ReadGuard &operator=(const ReadGuard &) = delete;
+
+   private:
+    std::atomic<uint64_t> *slot_;
+  };
+
+ public:
+  /**
+   * A consistent read-only view of the tree, unaffected by later writes
+   */
+  class Snapshot {
+    friend class PersistentRBTree;
+
+   public:
+    class Iterator {
+      friend class Snapshot;
+
+     public:
+      Iterator() = default;
+
+      bool operator==(const Iterator &other) const {
+        return stack_ == other.stack_;
+      }
+      bool operator!=(const Iterator &other) const {
+        return stack_ != other.stack_;
+      }
+
+      using reference = std::pair<const Key &, const Value &>;
+      struct pointer {
+        reference ref;
+        reference *operator->() { return &ref; }
+      };
+
+      pointer operator->() const { return pointer{**this}; }
+      reference operator*() const {
+        return {stack_.back()->key_, stack_.back()->value_};
+      }
+
+      Iterator &operator++() {
+        const Node *node = stack_.back()->right_.get();
+        stack_.pop_back();
+        pushLeft(node);
+        return *this;
+      }
+      Iterator operator++(int) {
+        Iterator tmp = *this;
+        ++*this;
+        return tmp;
+      }
+
+     private:
+      void pushLeft(const Node *node) {
+        for (; node; node = node->left_.get()) {
+          stack_.push_back(node);
+        }
+      }
+
+     private:
+      // the path to the current node, minus the nodes already passed
+      std::vector<const Node *> stack_;
+    };
+
+    using iterator = Iterator;
+
+    Snapshot() = default;
+
+    inline size_t size() const { return version_ ? version_->size_ : 0; }
+
+    inline bool empty() const { return size() == 0; }
+
+    /**
+     * @brief Get the value by specified key, return defaultValue if the key
+     * doesn't exist
+     *
+     * @param[in] key
+     * @param[in] defaultValue
+     * @return const Value&
+     */
+    const Value &get(const Key &key, const Value &defaultValue) const {
+      const Node *node =
+          version_ ? find(version_->root_, key, compareFunc_) : nullptr;
+      return node ? node->value_ : defaultValue;
+    }
+
+    inline bool contains(const Key &key) const {
+      return version_ && find(version_->root_, key, compareFunc_) != nullptr;
+    }
+
+    Iterator begin() const {
+      Iterator iter;
+      if (version_) {
+        iter.pushLeft(version_->root_.get());
+      }
+      return iter;
+    }
+    Iterator end() const { return Iterator(); }
+
+    /**
+     * @brief Check the red-black properties of this version
+     *
+     * @return true the version is valid
+     */
+    bool validate() const {
+      return !version_ || (colorOf(version_->root_) == BLACK &&
+                           validateInternal(version_->root_) != -1);
+    }
+
+   private:
+    Snapshot(VersionRef version, const Compare &compareFunc)
+        : version_(std::move(version)), compareFunc_(compareFunc) {}
+
+   private:
+    VersionRef version_;
+    Compare compareFunc_;
+  };
+
+ public:
+  PersistentRBTree() : current_(new Version(NodeRef(), 0)), epoch_(1) {}
+  ~PersistentRBTree() {
+    // no reader can be inside the tree anymore
+    for (auto &[epoch, version] : retired_) {
+      VersionRef released(version);
+    }
+    VersionRef released(current_.load(std::memory_order_relaxed));
+  }
+
+  PersistentRBTree(const PersistentRBTree &) = delete;
+  PersistentRBTree &operator=(const PersistentRBTree &) = delete;
+
+  /**
+   * @brief Take a snapshot of the latest version, without taking a lock or
+   * waiting for writers
+   *
+   * @return Snapshot
+   */
+  Snapshot snapshot() const {
+    ReadGuard guard(*this);
+    const Version *version = current_.load();
+    // the tree's own reference keeps it alive until the guard is gone
+    version->refs_.fetch_add(1, std::memory_order_relaxed);
+    return Snapshot(VersionRef(version), compareFunc_);
+  }
+
+  inline size_t size() const {
+    ReadGuard guard(*this);
+    return current_.load()->size_;
+  }
+
+  /**
+   * @brief Get the value of key in the latest version, return defaultValue
+   * if the key doesn't exist. The value is returned by copy, since the
+   * version holding it may be reclaimed right after the call.
+   *
+   * @param[in] key
+   * @param[in] defaultValue
+   * @return Value
+   */
+  Value get(const Key &key, const Value &defaultValue) const {
+    ReadGuard guard(*this);
+    const Node *node = find(current_.load()->root_, key, compareFunc_);
+    return node ? node->value_ : defaultValue;
+  }
+
+  /**
+   * @brief Publish a version where key maps to value, copying the path from
+   * the root to the key
+   *
+   * @param[in] key
+   * @param[in] value
+   */
+  void upsert(const Key &key, const Value &value) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const Version *old = current_.load(std::memory_order_relaxed);
+    bool added = false;
+    NodeRef root = blacken(upsertInternal(old->root_, key, value, added));
+    publish(std::move(root), old->size_ + added);
+  }
+
+  /**
+   * @brief Publish a version without key, if key exists
+   *
+   * @param[in] key
+   * @return true the key was removed
+   */
+  bool remove(const Key &key) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const Version *old = current_.load(std::memory_order_relaxed);
+    if (find(old->root_, key, compareFunc_) == nullptr) {
+      return false;
+    }
+    auto [left, found, right] = split(old->root_, key);
+    publish(blacken(join2(std::move(left), std::move(right))),
+            old->size_ - 1);
+    return true;
+  }
+
+ private:
+  static inline NodeColor colorOf(const NodeRef &node) {
+    return node ? node->color_ : BLACK;
+  }
+
+  static inline int blackHeightOf(const NodeRef &node) {
+    return node ? node->blackHeight_ : 0;
+  }
+
+  static inline NodeRef makeNode(NodeColor color, NodeRef left,
+                                 const Key &key, const Value &value,
+                                 NodeRef right) {
+    return NodeRef(
+        new Node(color, std::move(left), key, value, std::move(right)));
+  }
+
+  // a copy of the entry of node with new color and children
+  static inline NodeRef makeNode(NodeColor color, NodeRef left,
+                                 const Node &node, NodeRef right) {
+    return makeNode(color, std::move(left), node.key_, node.value_,
+                    std::move(right));
+  }
+
+  static NodeRef blacken(NodeRef node) {
+    if (colorOf(node) == RED) {
+      return makeNode(BLACK, node->left_, *node, node->right_);
+    }
+    return node;
+  }
+
+  /**
+   * @brief Make a new version current, and retire the replaced one in the
+   * epoch it was replaced in
+   *
+   * @param[in] root
+   * @param[in] size
+   */
+  void publish(NodeRef root, size_t size) {
+    const Version *old = current_.load(std::memory_order_relaxed);
+    current_.store(new Version(std::move(root), size));
+    retired_.emplace_back(epoch_.fetch_add(1), old);
+    reclaim();
+  }
+
+  /**
+   * @brief Drop the tree's reference to every retired version that no reader
+   * can still be about to retain, i.e. retired before the oldest announced
+   * epoch. Snapshots taken of it keep it alive on their own.
+   *
+   */
+  void reclaim() {
+    uint64_t oldest = UINT64_MAX;
+    for (const ReaderSlot &slot : slots_) {
+      if (uint64_t epoch = slot.epoch.load(); epoch != 0) {
+        oldest = std::min(oldest, epoch);
+      }
+    }
+    // retired_ is in epoch order
+    auto last = std::find_if(
+        retired_.begin(), retired_.end(),
+        [oldest](const auto &entry) { return entry.first >= oldest; });
+    for (auto iter = retired_.begin(); iter != last; ++iter) {
+      VersionRef released(iter->second);
+    }
+    retired_.erase(retired_.begin(), last);
+  }
+
+  static const Node *find(const NodeRef &root, const Key &key,
+                          const Compare &compareFunc) {
+    const Node *node = root.get();
+    while (node) {
+      int compareResult = compareFunc(key, node->key_);
+      if (compareResult == 0) {
+        return node;
+      }
+      node = compareResult < 0 ? node->left_.get() : node->right_.get();
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Return a copy of the subtree under node with key set to value.
+   * A red-red pair created below a black node is rotated away right there,
+   * as in Okasaki's functional insertion.
+   *
+   * @param[in] node
+   * @param[in] key
+   * @param[in] value
+   * @param[out] added whether key was not in the subtree yet
+   * @return NodeRef
+   */
+  NodeRef upsertInternal(const NodeRef &node, const Key &key,
+                         const Value &value, bool &added) {
+    if (!node) {
+      added = true;
+      return makeNode(RED, NodeRef(), key, value, NodeRef());
+    }
+    int compareResult = compareFunc_(key, node->key_);
+    if (compareResult < 0) {
+      return balance(node->color_,
+                     upsertInternal(node->left_, key, value, added), *node,
+                     node->right_);
+    }
+    if (compareResult > 0) {
+      return balance(node->color_, node->left_, *node,
+                     upsertInternal(node->right_, key, value, added));
+    }
+    return makeNode(node->color_, node->left_, key, value, node->right_);
+  }
+
+  /**
+   * @brief Build the node {left, entry, right}, turning a red child with a
+   * red child of its own into a red node over two black ones when the new
+   * node is black
+   *
+   * @param[in] color
+   * @param[in] left
+   * @param[in] entry
+   * @param[in] right
+   * @return NodeRef
+   */
+  static NodeRef balance(NodeColor color, NodeRef left, const Node &entry,
+                         NodeRef right) {
+    if (color == BLACK) {
+      if (colorOf(left) == RED && colorOf(left->left_) == RED) {
+        const Node &l = *left;
+        const Node &ll = *l.left_;
+        return makeNode(RED, makeNode(BLACK, ll.left_, ll, ll.right_), l,
+                        makeNode(BLACK, l.right_, entry, std::move(right)));
+      }
+      if (colorOf(left) == RED && colorOf(left->right_) == RED) {
+        const Node &l = *left;
+        const Node &lr = *l.right_;
+        return makeNode(RED, makeNode(BLACK, l.left_, l, lr.left_), lr,
+                        makeNode(BLACK, lr.right_, entry, std::move(right)));
+      }
+      if (colorOf(right) == RED && colorOf(right->left_) == RED) {
+        const Node &r = *right;
+        const Node &rl = *r.left_;
+        return makeNode(RED, makeNode(BLACK, std::move(left), entry, rl.left_),
+                        rl, makeNode(BLACK, rl.right_, r, r.right_));
+      }
+      if (colorOf(right) == RED && colorOf(right->right_) == RED) {
+        const Node &r = *right;
+        const Node &rr = *r.right_;
+        return makeNode(RED, makeNode(BLACK, std::move(left), entry, r.left_),
+                        r, makeNode(BLACK, rr.left_, rr, rr.right_));
+      }
+    }
+    return makeNode(color, std::move(left), entry, std::move(right));
+  }
+
+  /**
+   * @brief Join two trees and an entry whose key lies between them, copying
+   * only the spine of the taller tree down to the black height of the other
+   * one (Blelloch et al., "Just Join for Parallel Ordered Sets")
+   *
+   * @param[in] left
+   * @param[in] mid
+   * @param[in] right
+   * @return NodeRef
+   */
+  static NodeRef join(NodeRef left, const Node &mid, NodeRef right) {
+    left = blacken(std::move(left));
+    right = blacken(std::move(right));
+    const int leftHeight = blackHeightOf(left);
+    const int rightHeight = blackHeightOf(right);
+    if (leftHeight > rightHeight) {
+      return joinRight(left, mid, std::move(right), rightHeight);
+    }
+    if (rightHeight > leftHeight) {
+      return joinLeft(std::move(left), mid, right, leftHeight);
+    }
+    return makeNode(RED, std::move(left), mid, std::move(right));
+  }
+
+  // hang {.., mid, right} on the right spine of the taller left tree
+  static NodeRef joinRight(const NodeRef &left, const Node &mid,
+                           NodeRef right, int height) {
+    if (colorOf(left) == BLACK && blackHeightOf(left) == height) {
+      return makeNode(RED, left, mid, std::move(right));
+    }
+    NodeRef child = joinRight(left->right_, mid, std::move(right), height);
+    if (left->color_ == BLACK && colorOf(child) == RED &&
+        colorOf(child->right_) == RED) {
+      return makeNode(RED, makeNode(BLACK, left->left_, *left, child->left_),
+                      *child, blacken(child->right_));
+    }
+    return makeNode(left->color_, left->left_, *left, std::move(child));
+  }
+
+  // hang {left, mid, ..} on the left spine of the taller right tree
+  static NodeRef joinLeft(NodeRef left, const Node &mid, const NodeRef &right,
+                          int height) {
+    if (colorOf(right) == BLACK && blackHeightOf(right) == height) {
+      return makeNode(RED, std::move(left), mid, right);
+    }
+    NodeRef child = joinLeft(std::move(left), mid, right->left_, height);
+    if (right->color_ == BLACK && colorOf(child) == RED &&
+        colorOf(child->left_) == RED) {
+      return makeNode(RED, blacken(child->left_), *child,
+                      makeNode(BLACK, child->right_, *right, right->right_));
+    }
+    return makeNode(right->color_, std::move(child), *right, right->right_);
+  }
+
+  /**
+   * @brief Split the tree under node into the keys smaller than key, the
+   * node of key (nullptr if none) and the keys greater than key
+   *
+   * @param[in] node
+   * @param[in] key
+   * @return std::tuple<NodeRef, NodeRef, NodeRef>
+   */
+  std::tuple<NodeRef, NodeRef, NodeRef> split(const NodeRef &node,
+                                              const Key &key) {
+    if (!node) {
+      return {};
+    }
+    int compareResult = compareFunc_(key, node->key_);
+    if (compareResult < 0) {
+      auto [left, found, right] = split(node->left_, key);
+      return {std::move(left), std::move(found),
+              join(std::move(right), *node, node->right_)};
+    }
+    if (compareResult > 0) {
+      auto [left, found, right] = split(node->right_, key);
+      return {join(node->left_, *node, std::move(left)), std::move(found),
+              std::move(right)};
+    }
+    return {node->left_, node, node->right_};
+  }
+
+  // join two trees where every key of left is smaller than every key of right
+  static NodeRef join2(NodeRef left, NodeRef right) {
+    if (!left) {
+      return right;
+    }
+    auto [rest, last] = splitLast(left);
+    return join(std::move(rest), *last, std::move(right));
+  }
+
+  // split off the entry with the largest key
+  static std::pair<NodeRef, NodeRef> splitLast(const NodeRef &node) {
+    if (!node->right_) {
+      return {node->left_, node};
+    }
+    auto [rest, last] = splitLast(node->right_);
+    return {join(node->left_, *node, std::move(rest)), std::move(last)};
+  }
+
+  /**
+   * @brief Check the red-black properties of the subtree, return its black
+   * height or -1 if it is invalid
+   *
+   * @param[in] node
+   * @return int
+   */
+  static int validateInternal(const NodeRef &node) {
+    if (!node) {
+      return 0;
+    }
+    if (node->color_ == RED &&
+        (colorOf(node->left_) == RED || colorOf(node->right_) == RED)) {
+      return -1;
+    }
+    int left = validateInternal(node->left_);
+    int right = validateInternal(node->right_);
+    if (left == -1 || left != right) {
+      return -1;
+    }
+    int height = left + (node->color_ == BLACK);
+    return height == node->blackHeight_ ? height : -1;
+  }
+
+ private:
+  Compare compareFunc_;
+  // serializes writers, readers never take it
+  std::mutex writeMutex_;
+  // holds one reference to the latest version
+  std::atomic<const Version *> current_;
+  // advanced by every write
+  std::atomic<uint64_t> epoch_;
+  mutable std::array<ReaderSlot, READER_SLOTS> slots_;
+  // replaced versions the tree still references, with the epoch each was
+  // replaced in, only touched by writers
+  std::vector<std::pair<uint64_t, const Version *>> retired_;
+};
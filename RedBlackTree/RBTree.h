@@ -1,8 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 template <class T>
 struct comp {
@@ -13,59 +20,248 @@ struct comp {
   }
 };
 
-template <class Key, class Value, class Compare = comp<Key>>
+/**
+ * Transparent comparator, compares any two types that support == and <. With
+ * it, e.g. a std::string_view looks up a std::string key without building a
+ * std::string first.
+ */
+template <>
+struct comp<void> {
+  using is_transparent = void;
+
+  template <class L, class R>
+  int operator()(const L &lhs, const R &rhs) const {
+    if (lhs == rhs) return 0;
+    if (lhs < rhs) return -1;
+    return 1;
+  }
+};
+
+/**
+ * Red-black tree map. With SplitValues, nodes only hold keys and the values
+ * live in a parallel array next to them, which keeps searches on large trees
+ * within fewer cache lines. With OrderStatistics, every node also counts the
+ * nodes of its subtree, which enables rank / select / countRange in
+ * O(log n).
+ */
+template <class Key, class Value, class Compare = comp<Key>,
+          class Allocator = std::allocator<std::pair<Key, Value>>,
+          bool SplitValues = false, bool OrderStatistics = false>
 class RBTree {
   enum NodeColor { RED, BLACK, VOID };
+  struct NoValue {};
+  struct NoCount {};
+  using ValueSlot = std::conditional_t<SplitValues, NoValue, Value>;
+  using CountSlot = std::conditional_t<OrderStatistics, size_t, NoCount>;
+
   struct RBTreeNode {
-    explicit RBTreeNode(const Key &k, const Value &v)
-        : kv_(k, v),
-          color_(RED),
-          parent_(nullptr),
+    template <class K, class... V>
+    explicit RBTreeNode(K &&k, V &&...v)
+        : key_(std::forward<K>(k)),
+          value_(std::forward<V>(v)...),
+          count_(),
+          parentColor_(RED),
           left_(nullptr),
           right_(nullptr) {}
 
-    void setColor(NodeColor c) { color_ = c; }
-    void setParent(RBTreeNode *p) { parent_ = p; }
+    // the color lives in the low bit of the parent pointer
+    inline NodeColor color() const {
+      return static_cast<NodeColor>(parentColor_ & 1);
+    }
+    inline RBTreeNode *parent() const {
+      return reinterpret_cast<RBTreeNode *>(parentColor_ & ~uintptr_t(1));
+    }
+    void setColor(NodeColor c) {
+      parentColor_ = (parentColor_ & ~uintptr_t(1)) | c;
+    }
+    void setParent(RBTreeNode *p) {
+      parentColor_ = reinterpret_cast<uintptr_t>(p) | (parentColor_ & 1);
+    }
 
-    std::pair<Key, Value> kv_;
+    Key key_;
+    [[no_unique_address]] ValueSlot value_;
+    // number of nodes in the subtree, only with OrderStatistics
+    [[no_unique_address]] CountSlot count_;
 
-    NodeColor color_;
-    RBTreeNode *parent_;
+    uintptr_t parentColor_;
     RBTreeNode *left_;
     RBTreeNode *right_;
   };
 
-  class RBTreeIterator {
+  /**
+   * Per-tree node pool. Nodes are carved out of chunks aligned to their own
+   * size and erased nodes are reused through a free list. With SplitValues
+   * each chunk also holds the value array, so the value of a node is found
+   * from the node address alone. The chunks themselves belong to an arena
+   * shared by every pool whose nodes were ever joined together.
+   */
+  class NodePool {
+    static constexpr size_t SLOT_BYTES =
+        sizeof(RBTreeNode) + (SplitValues ? sizeof(Value) : 0);
+    static constexpr size_t CHUNK_BYTES =
+        std::max<size_t>(4096, std::bit_ceil(SLOT_BYTES * 32));
+    static constexpr size_t NODES_PER_CHUNK =
+        (CHUNK_BYTES - alignof(Value)) / SLOT_BYTES;
+    static constexpr size_t VALUES_OFFSET =
+        (NODES_PER_CHUNK * sizeof(RBTreeNode) + alignof(Value) - 1) &
+        ~(alignof(Value) - 1);
+
+    struct alignas(CHUNK_BYTES) Chunk {
+      unsigned char bytes[CHUNK_BYTES];
+    };
+    struct FreeNode {
+      FreeNode *next;
+    };
+    using ChunkAllocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Chunk>;
+    using ChunkTraits = std::allocator_traits<ChunkAllocator>;
+
+    struct OwnedChunk {
+      // the allocator of the pool that carved it, to give it back
+      [[no_unique_address]] ChunkAllocator alloc;
+      Chunk *chunk;
+    };
+
+    /**
+     * Owner of the chunks of a set of pools, merged as a union-find forest.
+     * A merged arena hands its chunks to the root and keeps the root alive,
+     * while a root never references the arenas merged into it, so arenas can
+     * not own each other whatever order trees are joined in.
+     */
+    struct ChunkArena {
+      ~ChunkArena() {
+        for (OwnedChunk &owned : chunks) {
+          ChunkTraits::deallocate(owned.alloc, owned.chunk, 1);
+        }
+      }
+
+      std::vector<OwnedChunk> chunks;
+      // set once this arena is merged into another one
+      std::shared_ptr<ChunkArena> parent;
+    };
+
    public:
-    RBTreeIterator() : object_(nullptr) {}
+    explicit NodePool(const Allocator &alloc)
+        : alloc_(alloc),
+          arena_(std::allocate_shared<ChunkArena>(alloc)),
+          freeList_(nullptr),
+          current_(nullptr),
+          used_(NODES_PER_CHUNK) {}
+
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+
+    inline Allocator allocator() const { return Allocator(alloc_); }
+
+    /**
+     * @brief Keep the chunks of other alive as long as this pool, because
+     * nodes carved out of them are about to be linked into our tree. Both
+     * arenas are merged, so the chunks live until neither pool is used.
+     *
+     * @param[in] other
+     */
+    void adopt(const std::shared_ptr<NodePool> &other) {
+      const std::shared_ptr<ChunkArena> &mine = arena();
+      const std::shared_ptr<ChunkArena> &theirs = other->arena();
+      if (mine == theirs) {
+        return;
+      }
+      mine->chunks.insert(mine->chunks.end(), theirs->chunks.begin(),
+                          theirs->chunks.end());
+      theirs->chunks.clear();
+      theirs->parent = mine;
+    }
 
-    explicit RBTreeIterator(RBTreeNode *ptr) : object_(ptr) {}
-    RBTreeIterator(const RBTreeIterator &other) : object_(other.object_) {}
-    RBTreeIterator(RBTreeIterator &&other) : object_(other.object_) {
-      other.object_ = nullptr;
+    void *allocate() {
+      if (FreeNode *node = freeList_; node) {
+        freeList_ = node->next;
+        return node;
+      }
+      if (used_ == NODES_PER_CHUNK) {
+        current_ = ChunkTraits::allocate(alloc_, 1);
+        arena()->chunks.push_back({alloc_, current_});
+        used_ = 0;
+      }
+      return current_->bytes + used_++ * sizeof(RBTreeNode);
     }
 
-    RBTreeIterator &operator=(const RBTreeIterator &other) {
-      object_ = other.object_;
-      return *this;
+    void deallocate(void *ptr) {
+      FreeNode *node = static_cast<FreeNode *>(ptr);
+      node->next = freeList_;
+      freeList_ = node;
     }
-    RBTreeIterator &operator=(RBTreeIterator &&other) {
-      object_ = other.object_;
-      other.object_ = nullptr;
-      return *this;
+
+    static inline Value *valueSlot(const RBTreeNode *node) {
+      uintptr_t addr = reinterpret_cast<uintptr_t>(node);
+      unsigned char *chunk =
+          reinterpret_cast<unsigned char *>(addr & ~(CHUNK_BYTES - 1));
+      size_t index = (addr & (CHUNK_BYTES - 1)) / sizeof(RBTreeNode);
+      return reinterpret_cast<Value *>(chunk + VALUES_OFFSET) + index;
     }
-    RBTreeIterator &operator=(RBTreeNode *ptr) {
-      object_ = ptr;
-      return *this;
+
+   private:
+    /**
+     * @brief Return the root arena, compressing the path to it on the way
+     *
+     * @return const std::shared_ptr<ChunkArena>&
+     */
+    const std::shared_ptr<ChunkArena> &arena() {
+      while (arena_->parent) {
+        arena_ = arena_->parent;
+      }
+      return arena_;
     }
 
-    bool operator==(const RBTreeIterator &other) {
+   private:
+    ChunkAllocator alloc_;
+    std::shared_ptr<ChunkArena> arena_;
+    FreeNode *freeList_;
+    // the chunk nodes are bump allocated from
+    Chunk *current_;
+    // nodes handed out from current_
+    size_t used_;
+  };
+
+  static inline Value &valueOf(RBTreeNode *node) {
+    if constexpr (SplitValues) {
+      return *NodePool::valueSlot(node);
+    } else {
+      return node->value_;
+    }
+  }
+
+  /**
+   * Bidirectional iterator in key order. end() is a null node, decrementing
+   * it yields the last node, so std::reverse_iterator works on top of it.
+   */
+  template <bool Const>
+  class RBTreeIterator {
+    friend class RBTree;
+
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::pair<const Key, Value>;
+    using difference_type = std::ptrdiff_t;
+    using reference =
+        std::pair<const Key &,
+                  std::conditional_t<Const, const Value &, Value &>>;
+    struct pointer {
+      reference ref;
+      reference *operator->() { return &ref; }
+    };
+
+    RBTreeIterator() : object_(nullptr), tree_(nullptr) {}
+    // a mutable iterator converts to a const one
+    template <bool OtherConst, class = std::enable_if_t<Const && !OtherConst>>
+    RBTreeIterator(const RBTreeIterator<OtherConst> &other)
+        : object_(other.object_), tree_(other.tree_) {}
+
+    bool operator==(const RBTreeIterator &other) const {
       return object_ == other.object_;
     }
-    bool operator==(RBTreeNode *ptr) { return object_ == ptr; }
 
-    std::pair<Key, Value> *operator->() { return &(object_->kv_); }
-    std::pair<Key, Value> &operator*() { return object_->kv_; }
+    pointer operator->() const { return pointer{**this}; }
+    reference operator*() const { return {object_->key_, valueOf(object_)}; }
 
     RBTreeIterator &operator++() {
       object_ = getSuccessor(object_);
@@ -78,42 +274,160 @@ class RBTree {
     }
 
     RBTreeIterator &operator--() {
-      object_ = getPredecessor(object_);
+      object_ = object_ ? getPredecessor(object_) : rightMost(tree_->root_);
       return *this;
     }
     RBTreeIterator operator--(int) {
       RBTreeIterator tmp = *this;
-      object_ = getPredecessor(object_);
+      --*this;
       return tmp;
     }
 
+   private:
+    RBTreeIterator(RBTreeNode *ptr, const RBTree *tree)
+        : object_(ptr), tree_(tree) {}
+
    private:
     RBTreeNode *object_;
+    // for decrementing end()
+    const RBTree *tree_;
   };
 
  public:
-  using iterator = RBTreeIterator;
+  using iterator = RBTreeIterator<false>;
+  using const_iterator = RBTreeIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  static constexpr size_t NODE_SIZE = sizeof(RBTreeNode);
+
+  // Compare declares is_transparent, so lookups accept anything it compares
+  // against Key, without converting it to a Key
+  static constexpr bool TRANSPARENT =
+      requires { typename Compare::is_transparent; };
 
  public:
-  RBTree() : root_(nullptr), size_(0), beginIter_(nullptr), endIter_(nullptr) {}
+  explicit RBTree(const Allocator &alloc = Allocator())
+      : pool_(std::allocate_shared<NodePool>(alloc, alloc)),
+        root_(nullptr),
+        size_(0),
+        first_(nullptr) {}
   ~RBTree() { destory(root_); }
 
-  inline size_t size() { return size_; }
+  RBTree(const RBTree &) = delete;
+  RBTree &operator=(const RBTree &) = delete;
+  // the moved-from tree is left empty, sharing the node pool
+  RBTree(RBTree &&other)
+      : compareFunc_(other.compareFunc_),
+        pool_(other.pool_),
+        root_(other.root_),
+        size_(other.size_),
+        first_(other.first_) {
+    other.root_ = nullptr;
+    other.size_ = 0;
+    other.first_ = nullptr;
+  }
+  RBTree &operator=(RBTree &&other) {
+    if (this != &other) {
+      destory(root_);
+      compareFunc_ = other.compareFunc_;
+      pool_ = other.pool_;
+      root_ = other.root_;
+      size_ = other.size_;
+      first_ = other.first_;
+      other.root_ = nullptr;
+      other.size_ = 0;
+      other.first_ = nullptr;
+    }
+    return *this;
+  }
 
-  inline bool empty() { return size_ == 0; }
+  inline size_t size() const { return size_; }
 
-  const RBTreeIterator &begin() { return beginIter_; }
-  const RBTreeIterator &end() { return endIter_; }
+  inline bool empty() const { return size_ == 0; }
+
+  iterator begin() { return iterator(first_, this); }
+  iterator end() { return iterator(nullptr, this); }
+  const_iterator begin() const { return const_iterator(first_, this); }
+  const_iterator end() const { return const_iterator(nullptr, this); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
 
   /**
-   * @brief Insert {key, value} if key doesn't exist, update the value else
+   * @brief Insert {key, value} if key doesn't exist, update the value else.
+   * Both are forwarded, so rvalues are moved into the node.
    *
    * @param[in] key
    * @param[in] value
    */
-  void upsert(const Key &key, const Value &value) {
-    upsertInternal(root_, key, value);
-    root_->setColor(BLACK);
+  template <class K, class V>
+    requires std::is_constructible_v<Key, K &&> &&
+             std::is_assignable_v<Value &, V &&>
+  void upsert(K &&key, V &&value) {
+    if constexpr (IS_LOOKUP_KEY<K>) {
+      upsertInternal(std::forward<K>(key), std::forward<V>(value));
+    } else {
+      upsertInternal(Key(std::forward<K>(key)), std::forward<V>(value));
+    }
+  }
+
+  /**
+   * @brief Insert key with a value constructed in place from args, unless
+   * key already exists, in which case args are left untouched
+   *
+   * @param[in] key
+   * @param[in] args
+   * @return std::pair<iterator, bool> the entry of key, and whether it was
+   * inserted
+   */
+  template <class K, class... Args>
+    requires std::is_constructible_v<Key, K &&>
+  std::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+    if constexpr (IS_LOOKUP_KEY<K>) {
+      InsertPosition pos = findPosition(key);
+      if (pos.node) {
+        return {iterator(pos.node, this), false};
+      }
+      RBTreeNode *node =
+          createNode(std::forward<K>(key), std::forward<Args>(args)...);
+      linkNode(node, pos);
+      return {iterator(node, this), true};
+    } else {
+      return try_emplace(Key(std::forward<K>(key)),
+                         std::forward<Args>(args)...);
+    }
+  }
+
+  /**
+   * @brief Construct key and value in a new node from key and args, then
+   * insert it unless its key already exists. Unlike try_emplace, the node is
+   * always built, which suits keys that are only known once constructed.
+   *
+   * @param[in] key
+   * @param[in] args
+   * @return std::pair<iterator, bool> the entry of key, and whether it was
+   * inserted
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> emplace(K &&key, Args &&...args) {
+    RBTreeNode *node =
+        createNode(std::forward<K>(key), std::forward<Args>(args)...);
+    InsertPosition pos = findPosition(node->key_);
+    if (pos.node) {
+      destroyNode(node);
+      return {iterator(pos.node, this), false};
+    }
+    linkNode(node, pos);
+    return {iterator(node, this), true};
   }
 
   /**
@@ -124,9 +438,10 @@ class RBTree {
    * @param[in] defaultValue
    * @return const Value&
    */
-  const Value &get(const Key &key, const Value &defaultValue) const {
-    RBTreeNode *node = getInternal(root_, key);
-    return node ? node->kv_.second : defaultValue;
+  template <class K>
+  const Value &get(const K &key, const Value &defaultValue) const {
+    RBTreeNode *node = getInternal(root_, toLookupKey(key));
+    return node ? valueOf(node) : defaultValue;
   }
 
   /**
@@ -146,13 +461,234 @@ class RBTree {
    *
    * @param[in] key
    */
-  void remove(const Key &key) {
-    removeInternal(root_, key);
-    if (size_ == 0) {
-      root_ = nullptr;
+  template <class K>
+  void remove(const K &key) {
+    removeInternal(toLookupKey(key));
+  }
+
+  /**
+   * @brief Return the number of keys smaller than key
+   *
+   * @param[in] key
+   * @return size_t
+   */
+  size_t rank(const Key &key) const {
+    static_assert(OrderStatistics, "rank needs OrderStatistics");
+    size_t res = 0;
+    RBTreeNode *node = root_;
+    while (node) {
+      if (compareFunc_(key, node->key_) <= 0) {
+        node = node->left_;
+      } else {
+        res += countOf(node->left_) + 1;
+        node = node->right_;
+      }
+    }
+    return res;
+  }
+
+  /**
+   * @brief Return an iterator to the k-th smallest key (from 0), or end() if
+   * there are no more than k keys
+   *
+   * @param[in] k
+   * @return iterator
+   */
+  iterator select(size_t k) { return iterator(selectNode(k), this); }
+  const_iterator select(size_t k) const {
+    return const_iterator(selectNode(k), this);
+  }
+
+  /**
+   * @brief Return the number of keys in [lo, hi)
+   *
+   * @param[in] lo
+   * @param[in] hi
+   * @return size_t
+   */
+  size_t countRange(const Key &lo, const Key &hi) const {
+    if (compareFunc_(lo, hi) >= 0) {
+      return 0;
+    }
+    return rank(hi) - rank(lo);
+  }
+
+  /**
+   * @brief Return an iterator to the first key not smaller than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  template <class K>
+  iterator lower_bound(const K &key) {
+    return iterator(boundInternal(toLookupKey(key), false), this);
+  }
+  template <class K>
+  const_iterator lower_bound(const K &key) const {
+    return const_iterator(boundInternal(toLookupKey(key), false), this);
+  }
+
+  /**
+   * @brief Return an iterator to the first key greater than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  template <class K>
+  iterator upper_bound(const K &key) {
+    return iterator(boundInternal(toLookupKey(key), true), this);
+  }
+  template <class K>
+  const_iterator upper_bound(const K &key) const {
+    return const_iterator(boundInternal(toLookupKey(key), true), this);
+  }
+
+  /**
+   * @brief Return the range of entries with key, empty or of one entry
+   *
+   * @param[in] key
+   * @return std::pair<iterator, iterator>
+   */
+  template <class K>
+  std::pair<iterator, iterator> equal_range(const K &key) {
+    decltype(auto) lookupKey = toLookupKey(key);
+    iterator first(boundInternal(lookupKey, false), this);
+    iterator last = first;
+    if (first.object_ && compareFunc_(lookupKey, first.object_->key_) == 0) {
+      ++last;
+    }
+    return {first, last};
+  }
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &key) const {
+    auto [first, last] = const_cast<RBTree *>(this)->equal_range(key);
+    return {first, last};
+  }
+
+  /**
+   * @brief Call fn(key, value) on every entry with a key in [lo, hi), in key
+   * order, descending only into subtrees that overlap the range
+   *
+   * @param[in] lo
+   * @param[in] hi
+   * @param[in] fn
+   */
+  template <class Fn>
+  void rangeForEach(const Key &lo, const Key &hi, Fn &&fn) const {
+    if (compareFunc_(lo, hi) < 0) {
+      rangeForEachInternal(root_, lo, hi, fn);
     }
   }
 
+  /**
+   * @brief Remove every entry
+   *
+   */
+  void clear() {
+    destory(root_);
+    root_ = nullptr;
+    size_ = 0;
+    first_ = nullptr;
+  }
+
+  /**
+   * @brief Replace the content of the tree with the {key, value} pairs of
+   * [first, last), sorted by strictly increasing key. The nodes are laid out
+   * perfectly balanced in O(n), without any comparison-driven descent or
+   * rotation.
+   *
+   * @param[in] first
+   * @param[in] last
+   */
+  template <class Iter>
+  void buildFromSorted(Iter first, Iter last) {
+    std::vector<RBTreeNode *> nodes;
+    if constexpr (std::forward_iterator<Iter>) {
+      nodes.reserve(std::distance(first, last));
+    }
+    for (; first != last; ++first) {
+      const auto &[key, value] = *first;
+      if (!nodes.empty() && compareFunc_(nodes.back()->key_, key) >= 0) {
+        for (RBTreeNode *node : nodes) {
+          destroyNode(node);
+        }
+        throw "Keys given to buildFromSorted are not strictly increasing";
+      }
+      nodes.push_back(createNode(key, value));
+    }
+    // the old content is only dropped once the input is known to be valid
+    clear();
+    relink(nodes);
+  }
+
+  /**
+   * @brief Move every entry whose key is not smaller than key into a new
+   * tree, in O(log n) (plus a count of the moved entries when the tree has
+   * no OrderStatistics). Both trees share the node pool.
+   *
+   * @param[in] key
+   * @return RBTree the entries >= key
+   */
+  RBTree split(const Key &key) {
+    RBTree res(pool_, compareFunc_);
+    auto [left, leftHeight, right, rightHeight] =
+        splitInternal(root_, blackHeight(root_), key);
+    size_t moved;
+    if constexpr (OrderStatistics) {
+      moved = countOf(right);
+    } else {
+      moved = countNodes(right);
+    }
+
+    root_ = left;
+    size_ -= moved;
+    first_ = root_ ? leftMost(root_) : nullptr;
+    res.root_ = right;
+    res.size_ = moved;
+    res.first_ = right ? leftMost(right) : nullptr;
+    return res;
+  }
+
+  /**
+   * @brief Move every entry of other into this tree, leaving other empty.
+   * When all keys of one tree are smaller than all keys of the other, the
+   * trees are joined in O(log n), otherwise both are merged in O(n + m) and
+   * other's value wins on equal keys. Nodes are relinked, never copied.
+   *
+   * @param[in] other
+   */
+  void join(RBTree &other) {
+    if (this == &other || other.root_ == nullptr) {
+      return;
+    }
+    pool_->adopt(other.pool_);
+
+    if (root_ == nullptr) {
+      root_ = other.root_;
+      size_ = other.size_;
+      first_ = other.first_;
+    } else if (compareFunc_(rightMost(root_)->key_,
+                            leftMost(other.root_)->key_) < 0) {
+      RBTreeNode *mid = leftMost(other.root_);
+      other.unlinkNode(mid);
+      size_ += other.size_ + 1;
+      root_ = join3(root_, mid, other.root_);
+    } else if (compareFunc_(rightMost(other.root_)->key_,
+                            leftMost(root_)->key_) < 0) {
+      RBTreeNode *mid = rightMost(other.root_);
+      other.unlinkNode(mid);
+      size_ += other.size_ + 1;
+      root_ = join3(other.root_, mid, root_);
+      first_ = leftMost(root_);
+    } else {
+      mergeRebuild(other);
+    }
+
+    other.root_ = nullptr;
+    other.size_ = 0;
+    other.first_ = nullptr;
+  }
+
   /* Only for debug */
   void print() {
     std::cout << "size: " << size_ << (validate() ? ", Valid\n" : ", Invalid\n")
@@ -160,11 +696,34 @@ class RBTree {
     printTreeStructure(root_, 0, '-');
   }
   /* Only for debug */
-  bool validate() {
-    return getColorByNode(root_) == BLACK ? validateInternal(root_) : false;
+  bool validate() const {
+    return getColorByNode(root_) == BLACK && validateInternal(root_) != -1;
   }
 
  private:
+  // K is compared against Key as is, without being converted to a Key
+  template <class K>
+  static constexpr bool IS_LOOKUP_KEY =
+      TRANSPARENT || std::is_same_v<std::remove_cvref_t<K>, Key>;
+
+  // the node of a key, or the parent it would be attached to
+  struct InsertPosition {
+    RBTreeNode *node;
+    RBTreeNode *parent;
+    // side of parent the key goes to
+    int compareResult;
+    // whether the key would become the smallest one
+    bool leftMostPath;
+  };
+
+  // an empty tree drawing nodes from an existing pool, used by split
+  RBTree(std::shared_ptr<NodePool> pool, const Compare &compareFunc)
+      : compareFunc_(compareFunc),
+        pool_(std::move(pool)),
+        root_(nullptr),
+        size_(0),
+        first_(nullptr) {}
+
   /**
    * @brief Get the color of tree node, the NIL node will be seemed as BLACK
    *
@@ -172,7 +731,36 @@ class RBTree {
    * @return NodeColor
    */
   inline NodeColor getColorByNode(RBTreeNode *node) const {
-    return node ? node->color_ : BLACK;
+    return node ? node->color() : BLACK;
+  }
+
+  static inline size_t countOf(RBTreeNode *node) {
+    return node ? node->count_ : 0;
+  }
+
+  static inline void updateCount(RBTreeNode *node) {
+    node->count_ = 1 + countOf(node->left_) + countOf(node->right_);
+  }
+
+  /**
+   * @brief Point the link that leads to node (its parent's child pointer, or
+   * root_) at replacement, and give replacement node's parent
+   *
+   * @param[in] node
+   * @param[in] replacement may be nullptr
+   */
+  void transplant(RBTreeNode *node, RBTreeNode *replacement) {
+    RBTreeNode *parent = node->parent();
+    if (parent == nullptr) {
+      root_ = replacement;
+    } else if (node == parent->left_) {
+      parent->left_ = replacement;
+    } else {
+      parent->right_ = replacement;
+    }
+    if (replacement) {
+      replacement->setParent(parent);
+    }
   }
 
   /**
@@ -181,19 +769,20 @@ class RBTree {
    *
    * @param[in] node
    */
-  static void leftRotate(RBTreeNode *&node) {
+  void leftRotate(RBTreeNode *node) {
     RBTreeNode *child = node->right_;
-    child->setParent(node->parent_);
-
     node->right_ = child->left_;
     if (child->left_) {
       child->left_->setParent(node);
     }
 
+    transplant(node, child);
     child->left_ = node;
     node->setParent(child);
-
-    node = child;
+    if constexpr (OrderStatistics) {
+      child->count_ = node->count_;
+      updateCount(node);
+    }
   }
 
   /**
@@ -202,19 +791,20 @@ class RBTree {
    *
    * @param[in] node
    */
-  static void rightRotate(RBTreeNode *&node) {
+  void rightRotate(RBTreeNode *node) {
     RBTreeNode *child = node->left_;
-    child->setParent(node->parent_);
-
     node->left_ = child->right_;
     if (child->right_) {
       child->right_->setParent(node);
     }
 
+    transplant(node, child);
     child->right_ = node;
     node->setParent(child);
-
-    node = child;
+    if constexpr (OrderStatistics) {
+      child->count_ = node->count_;
+      updateCount(node);
+    }
   }
 
   /**
@@ -227,10 +817,10 @@ class RBTree {
     if (node->left_) {
       return rightMost(node->left_);
     }
-    while (node->parent_ && node != node->parent_->right_) {
-      node = node->parent_;
+    while (node->parent() && node != node->parent()->right_) {
+      node = node->parent();
     }
-    return node->parent_;
+    return node->parent();
   }
 
   /**
@@ -243,184 +833,203 @@ class RBTree {
     if (node->right_) {
       return leftMost(node->right_);
     }
-    while (node->parent_ && node != node->parent_->left_) {
-      node = node->parent_;
+    while (node->parent() && node != node->parent()->left_) {
+      node = node->parent();
     }
-    return node->parent_;
+    return node->parent();
   }
 
   /**
    * @brief Find the leftmost node
    *
    * @param[in] node
-   * @return RBTreeNode*&
+   * @return RBTreeNode*
    */
-  static RBTreeNode *&leftMost(RBTreeNode *&node) {
-    return node->left_ ? leftMost(node->left_) : node;
+  static RBTreeNode *leftMost(RBTreeNode *node) {
+    while (node->left_) {
+      node = node->left_;
+    }
+    return node;
   }
 
   /**
    * @brief Find the rightmost node
    *
    * @param[in] node
-   * @return RBTreeNode*&
+   * @return RBTreeNode*
    */
-  static RBTreeNode *&rightMost(RBTreeNode *&node) {
-    return node->right_ ? rightMost(node->right_) : node;
+  static RBTreeNode *rightMost(RBTreeNode *node) {
+    while (node->right_) {
+      node = node->right_;
+    }
+    return node;
   }
 
   /**
-   * @brief Internal function for upsert node
+   * @brief Return key itself if Compare takes it as is, else key converted
+   * to a Key, once per lookup rather than once per comparison
+   *
+   * @param[in] key
+   * @return decltype(auto)
+   */
+  template <class K>
+  static decltype(auto) toLookupKey(const K &key) {
+    if constexpr (IS_LOOKUP_KEY<K>) {
+      return (key);
+    } else {
+      return Key(key);
+    }
+  }
+
+  /**
+   * @brief Update the value of key if it exists, else link a new node built
+   * from key and value
    *
-   * @param[in] node
    * @param[in] key
    * @param[in] value
    */
-  void upsertInternal(RBTreeNode *&node, const Key &key, const Value &value) {
-    if (node == nullptr) {
-      node = new RBTreeNode(key, value);
-      if (++size_ == 1) {
-        beginIter_ = node;
-      }
+  template <class K, class V>
+  void upsertInternal(K &&key, V &&value) {
+    InsertPosition pos = findPosition(key);
+    if (pos.node) {
+      valueOf(pos.node) = std::forward<V>(value);
       return;
     }
+    linkNode(createNode(std::forward<K>(key), std::forward<V>(value)), pos);
+  }
 
-    int compareResult = compareFunc_(key, node->kv_.first);
-    if (compareResult == 0) {
-      node->kv_.second = value;
-    } else if (compareResult < 0) {
-      RBTreeNode *&child = node->left_;
-      RBTreeNode *&sibling = node->right_;
-
-      upsertInternal(child, key, value);
-      child->setParent(node);
+  /**
+   * @brief Walk down to the node of key, or to where it would be attached
+   *
+   * @param[in] key
+   * @return InsertPosition
+   */
+  template <class K>
+  InsertPosition findPosition(const K &key) const {
+    InsertPosition pos{nullptr, nullptr, 0, true};
+    RBTreeNode *cur = root_;
+    while (cur) {
+      pos.compareResult = compareFunc_(key, cur->key_);
+      if (pos.compareResult == 0) {
+        pos.node = cur;
+        return pos;
+      }
+      pos.parent = cur;
+      if (pos.compareResult < 0) {
+        cur = cur->left_;
+      } else {
+        cur = cur->right_;
+        pos.leftMostPath = false;
+      }
+    }
+    return pos;
+  }
 
-      if (beginIter_ == node) {
-        --beginIter_;
+  /**
+   * @brief Attach node as a red leaf at pos, found by findPosition, then
+   * rebalance bottom-up through the parent pointers
+   *
+   * @param[in] node
+   * @param[in] pos
+   */
+  void linkNode(RBTreeNode *node, const InsertPosition &pos) {
+    RBTreeNode *parent = pos.parent;
+    node->setParent(parent);
+    if (parent == nullptr) {
+      root_ = node;
+    } else if (pos.compareResult < 0) {
+      parent->left_ = node;
+    } else {
+      parent->right_ = node;
+    }
+    ++size_;
+    if (pos.leftMostPath) {
+      first_ = node;
+    }
+    if constexpr (OrderStatistics) {
+      node->count_ = 1;
+      for (RBTreeNode *p = parent; p; p = p->parent()) {
+        ++p->count_;
       }
+    }
+    upsertFixup(node);
+  }
 
-      if (getColorByNode(child) == RED) {
-        if (getColorByNode(sibling) == BLACK) {
-          if (getColorByNode(child->left_) == RED) {
-            /*
-             * CASE 1
-             *   node -->    B
-             *              / \
-             *  child -->  R   B
-             *            /
-             *           R
-             */
-            child->setColor(BLACK);
-            node->setColor(RED);
-            rightRotate(node);
-          } else if (getColorByNode(child->right_) == RED) {
-            /*
-             * CASE 2
-             *   node -->    B
-             *              / \
-             *  child -->  R   B
-             *              \
-             *               R
-             */
-            leftRotate(child);
-            child->setColor(BLACK);
-            node->setColor(RED);
-            rightRotate(node);
-          }
-        } else {  // getColorByNode(sibling) == RED
-          if (getColorByNode(child->left_) == RED) {
-            /*
-             * CASE 3
-             *   node -->    B
-             *              / \
-             *  child -->  R   R
-             *            /
-             *           R
-             */
-            child->setColor(BLACK);
-            sibling->setColor(BLACK);
-            node->setColor(RED);
-          } else if (getColorByNode(child->right_) == RED) {
-            /*
-             * CASE 4
-             *   node -->    B
-             *              / \
-             *  child -->  R   R
-             *              \
-             *               R
-             */
-            leftRotate(child);
-            child->setColor(BLACK);
-            sibling->setColor(BLACK);
-            node->setColor(RED);
-          }
+  /**
+   * @brief Restore the red-black properties after node was attached as a red
+   * leaf
+   *
+   * @param[in] node
+   */
+  void upsertFixup(RBTreeNode *node) {
+    RBTreeNode *parent;
+    while ((parent = node->parent()) && parent->color() == RED) {
+      // a red parent is never the root, so the grandparent exists
+      RBTreeNode *grand = parent->parent();
+      if (parent == grand->left_) {
+        RBTreeNode *uncle = grand->right_;
+        if (getColorByNode(uncle) == RED) {
+          /*
+           * CASE 1: recolor and continue from the grandparent
+           *   grand -->    B
+           *               / \
+           *  parent -->  R   R <-- uncle
+           *              |
+           *              R <-- node
+           */
+          parent->setColor(BLACK);
+          uncle->setColor(BLACK);
+          grand->setColor(RED);
+          node = grand;
+          continue;
         }
-      }
-    } else {
-      RBTreeNode *&child = node->right_;
-      RBTreeNode *&sibling = node->left_;
-
-      upsertInternal(child, key, value);
-      child->setParent(node);
-
-      if (getColorByNode(child) == RED) {
-        if (getColorByNode(sibling) == BLACK) {
-          if (getColorByNode(child->right_) == RED) {
-            /*
-             * CASE 1
-             *     B   <-- node
-             *    / \
-             *   B   R <-- child
-             *        \
-             *        R
-             */
-            child->setColor(BLACK);
-            node->setColor(RED);
-            leftRotate(node);
-          } else if (getColorByNode(child->left_) == RED) {
-            /*
-             * CASE 2
-             *     B   <-- node
-             *    / \
-             *   B   R <-- child
-             *      /
-             *     R
-             */
-            rightRotate(child);
-            child->setColor(BLACK);
-            node->setColor(RED);
-            leftRotate(node);
-          }
-        } else {  // getColorByNode(sibling) == RED
-          if (getColorByNode(child->right_) == RED) {
-            /*
-             * CASE 3
-             *     B   <-- node
-             *    / \
-             *   R   R <-- child
-             *        \
-             *        R
-             */
-            child->setColor(BLACK);
-            sibling->setColor(BLACK);
-            node->setColor(RED);
-          } else if (getColorByNode(child->left_) == RED) {
-            /*
-             * CASE 4
-             *     B   <-- node
-             *    / \
-             *   R   R <-- child
-             *      /
-             *     R
-             */
-            rightRotate(child);
-            child->setColor(BLACK);
-            sibling->setColor(BLACK);
-            node->setColor(RED);
-          }
+        if (node == parent->right_) {
+          /*
+           * CASE 2: turn the inner child into an outer one
+           *   grand -->    B
+           *               / \
+           *  parent -->  R   B <-- uncle
+           *               \
+           *                R <-- node
+           */
+          node = parent;
+          leftRotate(node);
+          parent = node->parent();
+        }
+        /*
+         * CASE 3
+         *   grand -->    B
+         *               / \
+         *  parent -->  R   B <-- uncle
+         *             /
+         *   node --> R
+         */
+        parent->setColor(BLACK);
+        grand->setColor(RED);
+        rightRotate(grand);
+      } else {
+        RBTreeNode *uncle = grand->left_;
+        if (getColorByNode(uncle) == RED) {
+          // CASE 1, mirrored
+          parent->setColor(BLACK);
+          uncle->setColor(BLACK);
+          grand->setColor(RED);
+          node = grand;
+          continue;
+        }
+        if (node == parent->left_) {
+          // CASE 2, mirrored
+          node = parent;
+          rightRotate(node);
+          parent = node->parent();
         }
+        // CASE 3, mirrored
+        parent->setColor(BLACK);
+        grand->setColor(RED);
+        leftRotate(grand);
       }
     }
+    root_->setColor(BLACK);
   }
 
   /**
@@ -430,199 +1039,492 @@ class RBTree {
    * @param[in] key
    * @return RBTreeNode*
    */
-  RBTreeNode *getInternal(RBTreeNode *node, const Key &key) const {
-    if (node == nullptr) {
-      return nullptr;
+  template <class K>
+  RBTreeNode *getInternal(RBTreeNode *node, const K &key) const {
+    while (node) {
+      int compareResult = compareFunc_(key, node->key_);
+      if (compareResult == 0) {
+        return node;
+      }
+      node = compareResult < 0 ? node->left_ : node->right_;
     }
+    return nullptr;
+  }
 
-    int compareResult = compareFunc_(key, node->kv_.first);
-    if (compareResult == 0) {
-      return node;
+  /**
+   * @brief Find the first node with a key greater than key (upper) or not
+   * smaller than key (!upper)
+   *
+   * @param[in] key
+   * @param[in] upper
+   * @return RBTreeNode*
+   */
+  template <class K>
+  RBTreeNode *boundInternal(const K &key, bool upper) const {
+    RBTreeNode *res = nullptr;
+    RBTreeNode *node = root_;
+    while (node) {
+      int compareResult = compareFunc_(key, node->key_);
+      if (compareResult < 0 || (compareResult == 0 && !upper)) {
+        res = node;
+        node = node->left_;
+      } else {
+        node = node->right_;
+      }
     }
-    if (compareResult < 0) {
-      return getInternal(node->left_, key);
+    return res;
+  }
+
+  RBTreeNode *selectNode(size_t k) const {
+    static_assert(OrderStatistics, "select needs OrderStatistics");
+    RBTreeNode *node = root_;
+    while (node) {
+      size_t left = countOf(node->left_);
+      if (k == left) {
+        break;
+      }
+      if (k < left) {
+        node = node->left_;
+      } else {
+        k -= left + 1;
+        node = node->right_;
+      }
+    }
+    return node;
+  }
+
+  template <class Fn>
+  void rangeForEachInternal(RBTreeNode *node, const Key &lo, const Key &hi,
+                            Fn &fn) const {
+    while (node) {
+      bool aboveLo = compareFunc_(node->key_, lo) >= 0;
+      bool belowHi = compareFunc_(node->key_, hi) < 0;
+      if (aboveLo) {
+        rangeForEachInternal(node->left_, lo, hi, fn);
+      }
+      if (aboveLo && belowHi) {
+        fn(node->key_, static_cast<const Value &>(valueOf(node)));
+      }
+      // the right subtree continues in the loop, so the recursion only goes
+      // as deep as the tree
+      node = belowHi ? node->right_ : nullptr;
     }
-    return getInternal(node->right_, key);
   }
 
   /**
-   * @brief Swap two nodes' {key, value} and recursively remove.
+   * @brief Remove and destroy the node of key, if any
    *
-   * @param[in] node
    * @param[in] key
-   * @return NodeColor means which color of nodes are removed in the subtree
    */
-  NodeColor removeInternal(RBTreeNode *&node, const Key &key) {
-    if (node == nullptr) {
-      return VOID;
-    }
-
-    bool toLeft = true;
-    int compareResult = compareFunc_(key, node->kv_.first);
-    if (compareResult == 0) {
-      RBTreeNode *&swapNode =
-          node->left_ ? rightMost(node->left_)
-                      : (node->right_ ? leftMost(node->right_) : node);
-      if (node->left_ == nullptr && node->right_ == nullptr) {
-        // now the node must be leaf node
-        NodeColor color = node->color_;
-        if (beginIter_ == node) {
-          ++beginIter_;
-        }
-        delete node;
-        node = nullptr;
-        --size_;
-        return color;
+  template <class K>
+  void removeInternal(const K &key) {
+    if (RBTreeNode *node = getInternal(root_, key); node) {
+      unlinkNode(node);
+      destroyNode(node);
+    }
+  }
+
+  /**
+   * @brief Unlink node from the tree without destroying it, splicing in its
+   * successor when it has two children, then rebalance bottom-up
+   *
+   * @param[in] node
+   */
+  void unlinkNode(RBTreeNode *node) {
+    if (first_ == node) {
+      first_ = getSuccessor(first_);
+    }
+
+    // child takes the place of the node that is really unlinked, which may
+    // be nullptr, so its parent is tracked separately
+    NodeColor removedColor = node->color();
+    RBTreeNode *child;
+    RBTreeNode *childParent;
+    if (node->left_ == nullptr) {
+      child = node->right_;
+      childParent = node->parent();
+      transplant(node, child);
+    } else if (node->right_ == nullptr) {
+      child = node->left_;
+      childParent = node->parent();
+      transplant(node, child);
+    } else {
+      RBTreeNode *successor = leftMost(node->right_);
+      removedColor = successor->color();
+      child = successor->right_;
+      if (successor->parent() == node) {
+        childParent = successor;
+      } else {
+        childParent = successor->parent();
+        transplant(successor, child);
+        successor->right_ = node->right_;
+        successor->right_->setParent(successor);
       }
+      transplant(node, successor);
+      successor->left_ = node->left_;
+      successor->left_->setParent(successor);
+      successor->setColor(node->color());
+    }
 
-      std::swap(node->kv_.first, swapNode->kv_.first);
-      std::swap(node->kv_.second, swapNode->kv_.second);
-      if (node->left_ == nullptr) {
-        toLeft = false;
+    --size_;
+    if constexpr (OrderStatistics) {
+      for (RBTreeNode *p = childParent; p; p = p->parent()) {
+        updateCount(p);
       }
-    } else if (compareResult > 0) {
-      toLeft = false;
-    }
-
-    if (toLeft) {
-      if (removeInternal(node->left_, key) == BLACK) {
-        RBTreeNode *&sibling = node->right_;
-        if (getColorByNode(node) == BLACK) {
-          if (getColorByNode(sibling) == BLACK) {
-            /*
-             * CASE 1
-             *     B   <-- node
-             *    / \
-             *  (x)  B <-- sibling
-             */
-            sibling->setColor(RED);
-            return BLACK;
-          } else {
-            /*
-             * CASE 2
-             *     B   <-- node
-             *    / \
-             *  (x)  R <-- sibling
-             *      / \
-             *     B   B
-             */
-            sibling->setColor(BLACK);
-            sibling->left_->setColor(RED);
-            leftRotate(node);
-          }
-        } else {
-          if (getColorByNode(sibling->left_) == BLACK &&
-              getColorByNode(sibling->right_) == BLACK) {
-            /*
-             * CASE 3
-             *     R   <-- node
-             *    / \
-             *  (x)  B <-- sibling
-             */
-            node->setColor(BLACK);
-            sibling->setColor(RED);
-          }
-        }
+    }
+    if (removedColor == BLACK) {
+      removeFixup(child, childParent);
+    }
+  }
 
-        if (getColorByNode(sibling->left_) == RED) {
+  /**
+   * @brief Restore the red-black properties after a black node was unlinked,
+   * node carrying an extra black
+   *
+   * @param[in] node may be nullptr
+   * @param[in] parent
+   */
+  void removeFixup(RBTreeNode *node, RBTreeNode *parent) {
+    while (node != root_ && getColorByNode(node) == BLACK) {
+      if (node == parent->left_) {
+        RBTreeNode *sibling = parent->right_;
+        if (sibling->color() == RED) {
+          /*
+           * CASE 1: make the sibling black
+           *     ?   <-- parent
+           *    / \
+           *  (x)  R <-- sibling
+           */
+          sibling->setColor(BLACK);
+          parent->setColor(RED);
+          leftRotate(parent);
+          sibling = parent->right_;
+        }
+        if (getColorByNode(sibling->left_) == BLACK &&
+            getColorByNode(sibling->right_) == BLACK) {
           /*
-           * CASE 4
-           *     ?   <-- node
+           * CASE 2: push the extra black up
+           *     ?   <-- parent
            *    / \
            *  (x)  B <-- sibling
-           *      /
-           *     R
+           *      / \
+           *     B   B
            */
           sibling->setColor(RED);
-          sibling->left_->setColor(BLACK);
-          rightRotate(sibling);
+          node = parent;
+          parent = node->parent();
+          continue;
         }
-        if (getColorByNode(sibling->right_) == RED) {
+        if (getColorByNode(sibling->right_) == BLACK) {
           /*
-           * CASE 5
-           *     ?   <-- node
+           * CASE 3: make the far nephew red
+           *     ?   <-- parent
            *    / \
            *  (x)  B <-- sibling
-           *        \
-           *         R
+           *      / \
+           *     R   B
            */
-          sibling->setColor(node->color_);
-          node->setColor(BLACK);
-          sibling->right_->setColor(BLACK);
-          leftRotate(node);
+          sibling->left_->setColor(BLACK);
+          sibling->setColor(RED);
+          rightRotate(sibling);
+          sibling = parent->right_;
         }
-      }
-    } else {
-      if (removeInternal(node->right_, key) == BLACK) {
-        RBTreeNode *&sibling = node->left_;
-        if (getColorByNode(node) == BLACK) {
-          if (getColorByNode(sibling) == BLACK) {
-            /*
-             * CASE 1
-             *     node -->   B
-             *               / \
-             *  sibling --> B  (x)
-             */
-            sibling->setColor(RED);
-            return BLACK;
-          } else {
-            /*
-             * CASE 2
-             *     node -->   B
-             *               / \
-             *  sibling --> R  (x)
-             *             / \
-             *            B   B
-             */
-            sibling->setColor(BLACK);
-            sibling->right_->setColor(RED);
-            rightRotate(node);
-          }
-        } else {
-          if (getColorByNode(sibling->left_) == BLACK &&
-              getColorByNode(sibling->right_) == BLACK) {
-            /*
-             * CASE 3
-             *     node -->   R
-             *               / \
-             *  sibling --> B  (x)
-             */
-            node->setColor(BLACK);
-            sibling->setColor(RED);
-          }
+        /*
+         * CASE 4
+         *     ?   <-- parent
+         *    / \
+         *  (x)  B <-- sibling
+         *        \
+         *         R
+         */
+        sibling->setColor(parent->color());
+        parent->setColor(BLACK);
+        sibling->right_->setColor(BLACK);
+        leftRotate(parent);
+        node = root_;
+      } else {
+        RBTreeNode *sibling = parent->left_;
+        if (sibling->color() == RED) {
+          // CASE 1, mirrored
+          sibling->setColor(BLACK);
+          parent->setColor(RED);
+          rightRotate(parent);
+          sibling = parent->left_;
         }
-
-        if (getColorByNode(sibling->right_) == RED) {
-          /*
-           * CASE 4
-           *     node -->   ?
-           *               / \
-           *  sibling --> B  (x)
-           *               \
-           *                R
-           */
+        if (getColorByNode(sibling->left_) == BLACK &&
+            getColorByNode(sibling->right_) == BLACK) {
+          // CASE 2, mirrored
           sibling->setColor(RED);
+          node = parent;
+          parent = node->parent();
+          continue;
+        }
+        if (getColorByNode(sibling->left_) == BLACK) {
+          // CASE 3, mirrored
           sibling->right_->setColor(BLACK);
+          sibling->setColor(RED);
           leftRotate(sibling);
+          sibling = parent->left_;
         }
-        if (getColorByNode(sibling->left_) == RED) {
-          /*
-           * CASE 5
-           *     node -->   ?
-           *               / \
-           *  sibling --> B  (x)
-           *             /
-           *            R
-           */
-          sibling->setColor(node->color_);
-          node->setColor(BLACK);
-          sibling->left_->setColor(BLACK);
-          rightRotate(node);
-        }
+        // CASE 4, mirrored
+        sibling->setColor(parent->color());
+        parent->setColor(BLACK);
+        sibling->left_->setColor(BLACK);
+        rightRotate(parent);
+        node = root_;
       }
     }
+    if (node) {
+      node->setColor(BLACK);
+    }
+  }
+
+  /**
+   * @brief Link nodes, sorted by key, into a perfectly balanced tree. Every
+   * leaf is at the deepest level or the one above, so painting the deepest
+   * level red and everything else black is a valid coloring.
+   *
+   * @param[in] nodes
+   */
+  void relink(std::vector<RBTreeNode *> &nodes) {
+    size_ = nodes.size();
+    if (nodes.empty()) {
+      root_ = nullptr;
+      first_ = nullptr;
+      return;
+    }
+    const int redDepth = std::bit_width(nodes.size()) - 1;
+    root_ = buildBalanced(nodes.data(), nodes.size(), 0, redDepth);
+    root_->setParent(nullptr);
+    first_ = nodes.front();
+  }
+
+  RBTreeNode *buildBalanced(RBTreeNode **nodes, size_t n, int depth,
+                            int redDepth) {
+    if (n == 0) {
+      return nullptr;
+    }
+    const size_t mid = n / 2;
+    RBTreeNode *node = nodes[mid];
+    node->left_ = buildBalanced(nodes, mid, depth + 1, redDepth);
+    node->right_ =
+        buildBalanced(nodes + mid + 1, n - mid - 1, depth + 1, redDepth);
+    if (node->left_) {
+      node->left_->setParent(node);
+    }
+    if (node->right_) {
+      node->right_->setParent(node);
+    }
+    node->setColor(depth == redDepth && depth > 0 ? RED : BLACK);
+    if constexpr (OrderStatistics) {
+      node->count_ = n;
+    }
+    return node;
+  }
 
-    return VOID;
+  /**
+   * @brief Return the number of black nodes from node down to a leaf
+   *
+   * @param[in] node
+   * @return int
+   */
+  static int blackHeight(RBTreeNode *node) {
+    int res = 0;
+    for (; node; node = node->left_) {
+      res += node->color() == BLACK;
+    }
+    return res;
+  }
+
+  RBTreeNode *join3(RBTreeNode *left, RBTreeNode *mid, RBTreeNode *right) {
+    int height;
+    return join3(left, blackHeight(left), mid, right, blackHeight(right),
+                 height);
+  }
+
+  /**
+   * @brief Join two detached trees with black roots and a node whose key
+   * lies between them, in O(|black height difference| + 1). mid is hung
+   * where the spine of the taller tree reaches the black height of the other
+   * one, then fixed up as a fresh red leaf.
+   *
+   * @param[in] left may be nullptr
+   * @param[in] leftHeight the black height of left
+   * @param[in] mid
+   * @param[in] right may be nullptr
+   * @param[in] rightHeight the black height of right
+   * @param[out] height the black height of the joined tree
+   * @return RBTreeNode* the root of the joined tree
+   */
+  RBTreeNode *join3(RBTreeNode *left, int leftHeight, RBTreeNode *mid,
+                    RBTreeNode *right, int rightHeight, int &height) {
+    // rotations and the fixup work on root_, point it at the joined tree
+    RBTreeNode *saved = root_;
+    RBTreeNode *parent = nullptr;
+    if (leftHeight >= rightHeight) {
+      root_ = left;
+      RBTreeNode *cur = left;
+      for (int h = leftHeight; cur && (cur->color() == RED || h > rightHeight);
+           cur = cur->right_) {
+        h -= cur->color() == BLACK;
+        parent = cur;
+      }
+      mid->left_ = cur;
+      mid->right_ = right;
+      if (parent) {
+        parent->right_ = mid;
+      }
+    } else {
+      root_ = right;
+      RBTreeNode *cur = right;
+      for (int h = rightHeight; cur && (cur->color() == RED || h > leftHeight);
+           cur = cur->left_) {
+        h -= cur->color() == BLACK;
+        parent = cur;
+      }
+      mid->left_ = left;
+      mid->right_ = cur;
+      if (parent) {
+        parent->left_ = mid;
+      }
+    }
+    if (parent == nullptr) {
+      root_ = mid;
+    }
+    mid->setParent(parent);
+    mid->setColor(RED);
+    if (mid->left_) {
+      mid->left_->setParent(mid);
+    }
+    if (mid->right_) {
+      mid->right_->setParent(mid);
+    }
+    if constexpr (OrderStatistics) {
+      for (RBTreeNode *p = mid; p; p = p->parent()) {
+        updateCount(p);
+      }
+    }
+    upsertFixup(mid);
+
+    // the fixup keeps the black height below mid, and mid is still
+    // O(|black height difference| + 1) levels deep
+    height = std::min(leftHeight, rightHeight);
+    for (RBTreeNode *p = mid; p; p = p->parent()) {
+      height += p->color() == BLACK;
+    }
+
+    RBTreeNode *res = root_;
+    root_ = saved;
+    return res;
+  }
+
+  /**
+   * @brief Detach a subtree from its parent as a standalone tree
+   *
+   * @param[in] node may be nullptr
+   * @return RBTreeNode*
+   */
+  static RBTreeNode *detach(RBTreeNode *node) {
+    if (node) {
+      node->setParent(nullptr);
+      node->setColor(BLACK);
+    }
+    return node;
+  }
+
+  /**
+   * @brief The black height of a child of a black node of black height
+   * height, once the child is detached and painted black
+   *
+   * @param[in] child may be nullptr
+   * @param[in] height
+   * @return int
+   */
+  static inline int detachedHeight(RBTreeNode *child, int height) {
+    return height - 1 + (child && child->color() == RED);
+  }
+
+  // the two halves of a split with their black heights
+  struct SplitResult {
+    RBTreeNode *lower;
+    int lowerHeight;
+    RBTreeNode *upper;
+    int upperHeight;
+  };
+
+  /**
+   * @brief Split the detached tree under node into the keys smaller than key
+   * and the others, joining the pieces on the way back up. Black heights are
+   * carried along, so every join3 only costs the height difference of its
+   * pieces and the whole split stays O(log n).
+   *
+   * @param[in] node
+   * @param[in] height the black height of node
+   * @param[in] key
+   * @return SplitResult
+   */
+  SplitResult splitInternal(RBTreeNode *node, int height, const Key &key) {
+    if (node == nullptr) {
+      return {nullptr, 0, nullptr, 0};
+    }
+    const int leftHeight = detachedHeight(node->left_, height);
+    const int rightHeight = detachedHeight(node->right_, height);
+    RBTreeNode *left = detach(node->left_);
+    RBTreeNode *right = detach(node->right_);
+    node->left_ = node->right_ = nullptr;
+    node->setParent(nullptr);
+
+    SplitResult res;
+    if (compareFunc_(node->key_, key) < 0) {
+      res = splitInternal(right, rightHeight, key);
+      res.lower = join3(left, leftHeight, node, res.lower, res.lowerHeight,
+                        res.lowerHeight);
+    } else {
+      res = splitInternal(left, leftHeight, key);
+      res.upper = join3(res.upper, res.upperHeight, node, right, rightHeight,
+                        res.upperHeight);
+    }
+    return res;
+  }
+
+  static size_t countNodes(RBTreeNode *node) {
+    return node ? 1 + countNodes(node->left_) + countNodes(node->right_) : 0;
+  }
+
+  /**
+   * @brief Merge the nodes of other into this tree by key in O(n + m), then
+   * relink them balanced. On equal keys the node of other is kept.
+   *
+   * @param[in] other
+   */
+  void mergeRebuild(RBTree &other) {
+    std::vector<RBTreeNode *> merged;
+    merged.reserve(size_ + other.size_);
+    // destroyed once the walk no longer climbs through them
+    std::vector<RBTreeNode *> duplicates;
+    RBTreeNode *mine = leftMost(root_);
+    RBTreeNode *theirs = leftMost(other.root_);
+    while (mine || theirs) {
+      int compareResult =
+          mine == nullptr     ? 1
+          : theirs == nullptr ? -1
+                              : compareFunc_(mine->key_, theirs->key_);
+      if (compareResult < 0) {
+        merged.push_back(mine);
+        mine = getSuccessor(mine);
+      } else {
+        merged.push_back(theirs);
+        theirs = getSuccessor(theirs);
+        if (compareResult == 0) {
+          duplicates.push_back(mine);
+          mine = getSuccessor(mine);
+        }
+      }
+    }
+    for (RBTreeNode *dup : duplicates) {
+      destroyNode(dup);
+    }
+    relink(merged);
   }
 
   /**
@@ -640,7 +1542,28 @@ class RBTree {
     if (node->right_) {
       destory(node->right_);
     }
-    delete node;
+    destroyNode(node);
+  }
+
+  template <class K, class... Args>
+  RBTreeNode *createNode(K &&key, Args &&...args) {
+    void *ptr = pool_->allocate();
+    if constexpr (SplitValues) {
+      RBTreeNode *node = new (ptr) RBTreeNode(std::forward<K>(key));
+      new (NodePool::valueSlot(node)) Value(std::forward<Args>(args)...);
+      return node;
+    } else {
+      return new (ptr)
+          RBTreeNode(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+  }
+
+  void destroyNode(RBTreeNode *node) {
+    if constexpr (SplitValues) {
+      valueOf(node).~Value();
+    }
+    node->~RBTreeNode();
+    pool_->deallocate(node);
   }
 
   /* Only for debug */
@@ -662,13 +1585,13 @@ class RBTree {
 
     printTreeStructure(node->right_, depth + 1, '/');
     std::cout << std::string(depth * 4, ' ') << prefix << "--"
-              << colorToString(node->color_) << '(' << node->kv_.first << ", "
-              << node->kv_.second << ')' << endOfColor() << std::endl;
+              << colorToString(node->color()) << '(' << node->key_ << ", "
+              << valueOf(node) << ')' << endOfColor() << std::endl;
     printTreeStructure(node->left_, depth + 1, '\\');
   }
   /* Only for debug -- return the number of black nodes to the nil node, -1 for
    * invalid */
-  int validateInternal(RBTreeNode *node) {
+  int validateInternal(RBTreeNode *node) const {
     if (node == nullptr) {
       return 1;
     }
@@ -683,15 +1606,21 @@ class RBTree {
     if (left == -1 || right == -1 || left != right) {
       return -1;
     }
+    if constexpr (OrderStatistics) {
+      if (node->count_ != 1 + countOf(node->left_) + countOf(node->right_)) {
+        return -1;
+      }
+    }
     return color == BLACK ? left + 1 : left;
   }
 
  private:
   Compare compareFunc_;
+  std::shared_ptr<NodePool> pool_;
   RBTreeNode *root_;
 
   size_t size_;
 
-  RBTreeIterator beginIter_;
-  RBTreeIterator endIter_;
+  // leftmost node, for begin() in O(1)
+  RBTreeNode *first_;
 };
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedRBTree.h"
+#include "RBTree.h"
+
+template <class Tree>
+double benchGet(const Tree& tree, const std::vector<int64_t>& probes,
+                int64_t& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t key : probes) {
+    checksum += tree.get(key, -1);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         probes.size();
+}
+
+double benchMap(const std::map<int64_t, int64_t>& map,
+                const std::vector<int64_t>& probes, int64_t& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t key : probes) {
+    auto iter = map.find(key);
+    checksum += iter == map.end() ? -1 : iter->second;
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         probes.size();
+}
+
+// probes are string_views, converted to a std::string per lookup unless
+// the tree's comparator is transparent
+template <class Tree>
+double benchStringGet(const Tree& tree,
+                      const std::vector<std::string_view>& probes,
+                      int64_t& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::string_view key : probes) {
+    checksum += tree.get(key, -1);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         probes.size();
+}
+
+template <class Tree>
+double benchUpsert(Tree& tree, const std::vector<int64_t>& keys) {
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t key : keys) {
+    tree.upsert(key, key);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         keys.size();
+}
+
+int main(int argc, char** argv) {
+  using InlineTree = RBTree<int64_t, int64_t>;
+  using SplitTree =
+      RBTree<int64_t, int64_t, comp<int64_t>, std::allocator<int64_t>, true>;
+  std::cout << "node bytes: " << InlineTree::NODE_SIZE << " inline, "
+            << SplitTree::NODE_SIZE << " split\n";
+
+  std::mt19937_64 gen(42);
+  for (size_t n : {100000, 1000000, 4000000}) {
+    std::vector<int64_t> keys(n);
+    for (int64_t& key : keys) {
+      key = gen() >> 1;
+    }
+    std::vector<int64_t> probes(1000000);
+    for (int64_t& probe : probes) {
+      probe = keys[gen() % n];
+    }
+
+    InlineTree inlineTree;
+    SplitTree splitTree;
+    std::map<int64_t, int64_t> map;
+    for (int64_t key : keys) {
+      inlineTree.upsert(key, key & 0xff);
+      splitTree.upsert(key, key & 0xff);
+      map.emplace(key, key & 0xff);
+    }
+
+    int64_t inlineSum = 0, splitSum = 0, mapSum = 0;
+    double inlineNs = benchGet(inlineTree, probes, inlineSum);
+    double splitNs = benchGet(splitTree, probes, splitSum);
+    double mapNs = benchMap(map, probes, mapSum);
+    std::cout << "n = " << n << ": inline " << inlineNs << " ns/get, split "
+              << splitNs << " ns/get, std::map " << mapNs << " ns/find"
+              << (inlineSum == splitSum && splitSum == mapSum ? ""
+                                                               : " (MISMATCH)")
+              << '\n';
+  }
+
+  {
+    // keys beyond the small string buffer, so a conversion allocates
+    std::vector<std::string> keys(1000000);
+    for (std::string& key : keys) {
+      key = "user:" + std::to_string(gen()) + ":profile";
+    }
+    std::vector<std::string_view> probes(1000000);
+    for (std::string_view& probe : probes) {
+      probe = keys[gen() % keys.size()];
+    }
+    RBTree<std::string, int64_t> converting;
+    RBTree<std::string, int64_t, comp<void>> transparent;
+    for (const std::string& key : keys) {
+      converting.upsert(key, key.size());
+      transparent.upsert(key, key.size());
+    }
+    int64_t convertingSum = 0, transparentSum = 0;
+    double convertingNs = benchStringGet(converting, probes, convertingSum);
+    double transparentNs = benchStringGet(transparent, probes, transparentSum);
+    std::cout << "string_view get: " << convertingNs << " ns converting, "
+              << transparentNs << " ns transparent"
+              << (convertingSum == transparentSum ? "" : " (MISMATCH)")
+              << '\n';
+  }
+
+  // upsert throughput on random and sequential keys, n defaults to 10M
+  const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  std::vector<int64_t> sequential(n);
+  std::vector<int64_t> shuffled(n);
+  for (size_t i = 0; i < n; i++) {
+    sequential[i] = shuffled[i] = i;
+  }
+  std::shuffle(shuffled.begin(), shuffled.end(), gen);
+  {
+    InlineTree tree;
+    std::cout << "upsert " << n << " random keys: "
+              << benchUpsert(tree, shuffled) << " ns/upsert\n";
+
+    // startup: rebuild the same tree from a saved file instead
+    using Mapped = MappedRBTree<int64_t, int64_t>;
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "RBTreeBench.rbt").string();
+    Mapped::save(tree, path);
+    auto start = std::chrono::steady_clock::now();
+    InlineTree loaded;
+    {
+      Mapped view(path);
+      loaded.buildFromSorted(view.begin(), view.end());
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "load " << n << " keys from a mapped file: "
+              << std::chrono::duration<double, std::nano>(end - start).count() /
+                     n
+              << " ns/key" << (loaded.size() == n ? "" : " (MISMATCH)")
+              << '\n';
+    std::filesystem::remove(path);
+  }
+  {
+    InlineTree tree;
+    std::cout << "upsert " << n << " sequential keys: "
+              << benchUpsert(tree, sequential) << " ns/upsert\n";
+  }
+  return 0;
+}
@@ -1,7 +1,54 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include "../Buddy/SlabAllocator.h"
+#include "MappedRBTree.h"
+#include "PersistentRBTree.h"
 #include "RBTree.h"
 
+// RBTreeTest builds in Release, so checks must not compile away like assert
+static void expect(bool cond, const char *what) {
+  if (!cond) {
+    std::cerr << "check failed: " << what << std::endl;
+    exit(-1);
+  }
+}
+
+// std::allocator that counts the blocks it has handed out and not got back
+static long liveBlocks = 0;
+template <class T>
+struct CountingAllocator : std::allocator<T> {
+  template <class U>
+  struct rebind {
+    using other = CountingAllocator<U>;
+  };
+
+  CountingAllocator() = default;
+  template <class U>
+  CountingAllocator(const CountingAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    liveBlocks++;
+    return std::allocator<T>::allocate(n);
+  }
+  void deallocate(T *ptr, size_t n) {
+    liveBlocks--;
+    std::allocator<T>::deallocate(ptr, n);
+  }
+};
+
 int main() {
   RBTree<int, int> tree;
   std::vector nums = {10, 20, 30, 15, 12, 25, 28, 27};
@@ -30,5 +77,450 @@ int main() {
     std::cout << '\n';
   }
 
+  std::cout << "\n## RANDOM ##\n";
+  {
+    RBTree<int, int> randomTree;
+    std::map<int, int> reference;
+    std::mt19937 gen(7);
+    for (int op = 0; op < 200000; op++) {
+      int key = gen() % 5000;
+      if (gen() % 3 == 0) {
+        randomTree.remove(key);
+        reference.erase(key);
+      } else {
+        randomTree.upsert(key, op);
+        reference[key] = op;
+      }
+      if (op % 20000 == 0) {
+        expect(randomTree.validate(), "random tree invariants");
+      }
+    }
+    expect(randomTree.size() == reference.size(), "random tree size");
+    auto expected = reference.begin();
+    for (auto iter = randomTree.begin(); iter != randomTree.end(); iter++) {
+      expect(iter->first == expected->first &&
+                 iter->second == expected->second,
+             "random tree contents");
+      ++expected;
+    }
+    expect(expected == reference.end(), "random tree iteration");
+    std::cout << "random upsert/remove against std::map passed\n";
+  }
+
+  std::cout << "\n## ORDER STATISTICS ##\n";
+  {
+    RBTree<int, int, comp<int>, std::allocator<int>, false, true> ranked;
+    std::map<int, int> reference;
+    std::mt19937 gen(11);
+    for (int op = 0; op < 50000; op++) {
+      int key = gen() % 2000;
+      if (gen() % 3 == 0) {
+        ranked.remove(key);
+        reference.erase(key);
+      } else {
+        ranked.upsert(key, key);
+        reference[key] = key;
+      }
+    }
+    expect(ranked.validate(), "ranked tree invariants and counts");
+
+    std::vector<int> sorted;
+    for (auto &[key, value] : reference) {
+      sorted.push_back(key);
+    }
+    for (int key = -1; key <= 2000; key += 7) {
+      size_t expected =
+          std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+      expect(ranked.rank(key) == expected, "rank");
+    }
+    for (size_t k = 0; k < sorted.size(); k += 13) {
+      expect(ranked.select(k)->first == sorted[k], "select");
+    }
+    expect(ranked.select(sorted.size()) == ranked.end(), "select past end");
+    expect(ranked.countRange(100, 600) ==
+               static_cast<size_t>(
+                   std::lower_bound(sorted.begin(), sorted.end(), 600) -
+                   std::lower_bound(sorted.begin(), sorted.end(), 100)),
+           "countRange");
+    expect(ranked.countRange(600, 100) == 0, "empty countRange");
+    std::cout << "rank/select/countRange passed\n";
+  }
+
+  std::cout << "\n## SLAB ##\n";
+  {
+    using Slab = SlabAllocator<1 << 20>;
+    using Alloc = SlabNodeAllocator<std::pair<int, int>, Slab>;
+    Slab slab;
+    RBTree<int, int, comp<int>, Alloc> slabTree{Alloc(slab)};
+    for (int i = 0; i < 1000; i++) {
+      slabTree.upsert(i, -i);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+      slabTree.remove(i);
+    }
+    expect(slabTree.validate() && slabTree.size() == 500, "slab tree");
+    expect(slabTree.get(999, 0) == -999 && slabTree.get(998, 0) == 0,
+           "slab tree get");
+  }
+
+  std::cout << "\n## SPLIT VALUES ##\n";
+  {
+    RBTree<int, std::string, comp<int>, std::allocator<int>, true> split;
+    for (int i = 0; i < 10000; i++) {
+      split.upsert(i * 7 % 10000, std::to_string(i));
+    }
+    for (int i = 0; i < 10000; i += 3) {
+      split.remove(i);
+    }
+    split.upsert(3, "three");
+    expect(split.validate() && split.get(3, "") == "three", "split upsert");
+    expect(split.get(6, "") == "" && split.get(7, "") == "1", "split get");
+    int prev = -1;
+    for (auto iter = split.begin(); iter != split.end(); iter++) {
+      expect(iter->first > prev, "split order");
+      prev = iter->first;
+    }
+    std::cout << "node bytes: " << RBTree<int64_t, int64_t>::NODE_SIZE
+              << " inline, "
+              << RBTree<int64_t, int64_t, comp<int64_t>,
+                        std::allocator<int64_t>, true>::NODE_SIZE
+              << " split\n";
+  }
+
+  std::cout << "\n## BUILD / SPLIT / JOIN ##\n";
+  {
+    using Ranked = RBTree<int, int, comp<int>, std::allocator<int>, false,
+                          true>;
+    std::vector<std::pair<int, int>> sorted;
+    for (int i = 0; i < 100000; i++) {
+      sorted.emplace_back(i * 2, i);
+    }
+    Ranked built;
+    built.buildFromSorted(sorted.begin(), sorted.end());
+    expect(built.validate() && built.size() == sorted.size(), "build");
+    expect(built.get(2000, -1) == 1000 && built.get(2001, -1) == -1,
+           "build get");
+    expect(built.select(777)->first == 1554, "build select");
+
+    Ranked upper = built.split(60001);
+    expect(built.validate() && upper.validate(), "split invariants");
+    expect(built.size() == 30001 && upper.size() == 69999, "split sizes");
+    auto upperFirst = upper.begin();
+    expect(built.rank(60001) == 30001 && upperFirst->first == 60002,
+           "split boundary");
+
+    built.join(upper);
+    expect(built.validate() && built.size() == sorted.size(), "ordered join");
+    auto upperBegin = upper.begin();
+    expect(upper.size() == 0 && upperBegin == upper.end(), "joined empty");
+    int expected = 0;
+    for (auto iter = built.begin(); iter != built.end(); iter++) {
+      expect(iter->first == expected, "join order");
+      expected += 2;
+    }
+
+    // the lower half joined into the upper one
+    Ranked high = built.split(100000);
+    high.join(built);
+    expect(high.validate() && high.size() == sorted.size(), "reverse join");
+
+    RBTree<int, int> overlap, other;
+    for (int i = 0; i < 1000; i++) {
+      overlap.upsert(i, 0);
+      other.upsert(i * 3, 1);
+    }
+    overlap.join(other);
+    expect(overlap.validate() && overlap.size() == 1666,
+           "overlapping join");
+    expect(overlap.get(3, -1) == 1 && overlap.get(4, -1) == 0 &&
+               overlap.get(2997, -1) == 1,
+           "overlapping join keeps other's values");
+
+    bool thrown = false;
+    try {
+      std::vector<std::pair<int, int>> unsorted = {{1, 1}, {1, 2}};
+      overlap.buildFromSorted(unsorted.begin(), unsorted.end());
+    } catch (const char *) {
+      thrown = true;
+    }
+    expect(thrown && overlap.size() == 1666 && overlap.validate() &&
+               overlap.get(3, -1) == 1,
+           "unsorted build throws and keeps the old content");
+
+    // single pass input, which must not be walked twice
+    std::istringstream in("1 3 5 7");
+    auto pairs = std::ranges::subrange(std::istream_iterator<int>(in),
+                                       std::istream_iterator<int>()) |
+                 std::views::transform([](int i) { return std::pair(i, -i); });
+    overlap.buildFromSorted(pairs.begin(), pairs.end());
+    expect(overlap.validate() && overlap.size() == 4 &&
+               overlap.get(7, 0) == -7,
+           "build from input iterators");
+  }
+
+  {
+    // trees of two pools joined into each other both ways must still give
+    // every chunk back once they are all gone
+    using Counted = RBTree<int, int, comp<int>, CountingAllocator<int>>;
+    {
+      Counted a, b;
+      for (int i = 0; i < 1000; i++) {
+        a.upsert(i, i);
+        b.upsert(i + 1000, i);
+      }
+      Counted aHigh = a.split(500);
+      Counted bHigh = b.split(1500);
+      a.join(b);
+      bHigh.join(aHigh);
+      expect(a.validate() && a.size() == 1000 && bHigh.size() == 1000,
+             "cross joins");
+    }
+    expect(liveBlocks == 0, "cross joined pools are freed");
+  }
+
+  std::cout << "\n## PERSISTENT ##\n";
+  {
+    PersistentRBTree<int, int> persistent;
+    std::map<int, int> reference;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 20000; i++) {
+      int key = rng() % 5000;
+      if (rng() % 3 == 0) {
+        expect(persistent.remove(key) == (reference.erase(key) == 1),
+               "persistent remove result");
+      } else {
+        persistent.upsert(key, i);
+        reference[key] = i;
+      }
+      if (i % 1000 == 0) {
+        expect(persistent.snapshot().validate(), "persistent invariants");
+      }
+    }
+    auto snapshot = persistent.snapshot();
+    expect(snapshot.validate() && snapshot.size() == reference.size(),
+           "persistent size");
+    auto expected = reference.begin();
+    for (auto [key, value] : snapshot) {
+      expect(key == expected->first && value == expected->second,
+             "persistent iteration");
+      ++expected;
+    }
+
+    // later writes leave the snapshot untouched
+    for (auto [key, value] : reference) {
+      persistent.remove(key);
+    }
+    persistent.upsert(-1, -1);
+    expect(persistent.size() == 1 && persistent.get(-1, 0) == -1,
+           "persistent after removal");
+    expect(snapshot.size() == reference.size() &&
+               snapshot.get(reference.begin()->first, -1) ==
+                   reference.begin()->second,
+           "snapshot isolation");
+
+    // readers check every version they see while one thread writes
+    PersistentRBTree<int, int> shared;
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+      readers.emplace_back([&] {
+        while (!done.load()) {
+          auto version = shared.snapshot();
+          size_t count = 0;
+          int prev = -1;
+          for (auto [key, value] : version) {
+            expect(key > prev && value == key * 2, "reader order");
+            prev = key;
+            count++;
+          }
+          expect(count == version.size(), "reader size");
+          // the latest version is read without a snapshot as well
+          int key = count % 20000;
+          int value = shared.get(key, -1);
+          expect(value == -1 || value == key * 2, "reader get");
+          expect(shared.size() <= 20000, "reader tree size");
+        }
+      });
+    }
+    for (int i = 0; i < 20000; i++) {
+      shared.upsert(i * 7919 % 20000, i * 7919 % 20000 * 2);
+      if (i % 4 == 3) {
+        shared.remove(i * 7919 % 20000);
+      }
+    }
+    done = true;
+    for (auto &reader : readers) {
+      reader.join();
+    }
+    expect(shared.snapshot().validate() && shared.size() == 15000,
+           "concurrent writes");
+  }
+
+  std::cout << "\n## BOUNDS / RANGES ##\n";
+  {
+    RBTree<int, int> bounded;
+    std::map<int, int> reference;
+    for (int i = 0; i < 2000; i++) {
+      bounded.upsert(i * 5, i);
+      reference[i * 5] = i;
+    }
+    const RBTree<int, int> &view = bounded;
+    for (int key = -3; key < 10010; key += 7) {
+      auto lower = view.lower_bound(key);
+      auto expectedLower = reference.lower_bound(key);
+      expect(expectedLower == reference.end()
+                 ? lower == view.end()
+                 : lower->first == expectedLower->first,
+             "lower_bound");
+      auto upper = bounded.upper_bound(key);
+      auto expectedUpper = reference.upper_bound(key);
+      expect(expectedUpper == reference.end()
+                 ? upper == bounded.end()
+                 : upper->first == expectedUpper->first,
+             "upper_bound");
+      auto [first, last] = view.equal_range(key);
+      expect(std::distance(first, last) == (key % 5 == 0 && key >= 0 &&
+                                            key < 10000),
+             "equal_range");
+    }
+
+    // writes through a mutable iterator, read back through const ones
+    bounded.lower_bound(500)->second = -1;
+    expect(view.lower_bound(499)->second == -1, "write through iterator");
+    bounded.upsert(500, 100);
+
+    auto expected = reference.rbegin();
+    for (auto iter = view.rbegin(); iter != view.rend(); ++iter) {
+      expect(iter->first == expected->first, "reverse iteration");
+      ++expected;
+    }
+    expect(expected == reference.rend(), "reverse iteration length");
+    auto last = bounded.end();
+    expect((--last)->first == 9995, "decrement end");
+
+    std::vector<int> visited;
+    view.rangeForEach(1001, 1500, [&](const int &key, const int &value) {
+      expect(value == key / 5, "rangeForEach value");
+      visited.push_back(key);
+    });
+    std::vector<int> expectedKeys;
+    for (auto iter = reference.lower_bound(1001);
+         iter != reference.lower_bound(1500); ++iter) {
+      expectedKeys.push_back(iter->first);
+    }
+    expect(visited == expectedKeys, "rangeForEach keys");
+    view.rangeForEach(7, 7, [](const int &, const int &) {
+      expect(false, "empty rangeForEach");
+    });
+  }
+
+  std::cout << "\n## TRANSPARENT / EMPLACE ##\n";
+  {
+    RBTree<std::string, int, comp<void>> names;
+    names.upsert(std::string_view("alice"), 1);
+    names.upsert("bob", 2);
+    std::string carol = "carol";
+    names.upsert(std::move(carol), 3);
+    std::string_view bob = "bob";
+    expect(names.get(bob, 0) == 2 && names.get("alice", 0) == 1 &&
+               names.get(std::string("carol"), 0) == 3,
+           "transparent get");
+    expect(names.lower_bound(std::string_view("b"))->first == "bob" &&
+               names.upper_bound(bob)->first == "carol",
+           "transparent bounds");
+    auto [first, last] = names.equal_range(bob);
+    expect(std::distance(first, last) == 1, "transparent equal_range");
+    names.remove(std::string_view("alice"));
+    expect(names.size() == 2 && names.get("alice", 0) == 0,
+           "transparent remove");
+
+    auto [bobIter, bobAdded] = names.try_emplace(bob, 20);
+    expect(!bobAdded && bobIter->second == 2, "try_emplace existing");
+    auto [daveIter, daveAdded] = names.try_emplace("dave", 4);
+    expect(daveAdded && daveIter->second == 4 && names.validate(),
+           "try_emplace new");
+    auto [eveIter, eveAdded] = names.emplace(std::string(3, 'e'), 5);
+    expect(eveAdded && eveIter->first == "eee", "emplace new");
+    expect(!names.emplace("bob", 7).second && names.get(bob, 0) == 2,
+           "emplace existing");
+
+    // move-only values are moved in, never copied
+    RBTree<int, std::unique_ptr<int>> owners;
+    owners.upsert(1, std::make_unique<int>(10));
+    owners.upsert(1, std::make_unique<int>(11));
+    auto [ownerIter, ownerAdded] = owners.try_emplace(2, new int(20));
+    expect(ownerAdded && *ownerIter->second == 20, "move-only try_emplace");
+    expect(owners.size() == 2 && *owners.get(1, nullptr) == 11,
+           "move-only upsert");
+    owners.remove(1);
+    expect(owners.validate() && owners.get(1, nullptr) == nullptr,
+           "move-only remove");
+  }
+
+  std::cout << "\n## SAVE / MAP ##\n";
+  {
+    using Tree = RBTree<int64_t, double>;
+    using Mapped = MappedRBTree<int64_t, double>;
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "RBTreeTest.rbt").string();
+    Tree tree;
+    for (int64_t i = 0; i < 50000; i++) {
+      tree.upsert(i * 7919 % 100003, i * 0.5);
+    }
+    Mapped::save(tree, path);
+
+    {
+      Mapped view(path);
+      expect(view.size() == tree.size(), "mapped size");
+      auto expected = tree.begin();
+      for (auto [key, value] : view) {
+        expect(key == expected->first && value == expected->second,
+               "mapped iteration");
+        ++expected;
+      }
+      for (int64_t key = -1; key < 100005; key += 13) {
+        expect(view.get(key, -1) == tree.get(key, -1), "mapped get");
+        auto lower = view.lower_bound(key);
+        auto treeLower = tree.lower_bound(key);
+        expect(treeLower == tree.end() ? lower == view.end()
+                                       : lower->first == treeLower->first,
+               "mapped lower_bound");
+      }
+
+      // mutable copy, built in O(n) without rebalancing
+      Tree loaded;
+      loaded.buildFromSorted(view.begin(), view.end());
+      expect(loaded.validate() && loaded.size() == tree.size() &&
+                 loaded.get(7919, -1) == 0.5,
+             "loaded tree");
+      loaded.upsert(-5, 1.0);
+      expect(loaded.validate() && loaded.begin()->first == -5,
+             "loaded tree stays mutable");
+    }
+
+    Tree empty;
+    Mapped::save(empty, path);
+    expect(Mapped(path).empty(), "empty file");
+
+    // a truncated file is refused rather than read past its end
+    Mapped::save(tree, path);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    bool thrown = false;
+    try {
+      Mapped view(path);
+    } catch (const std::string &) {
+      thrown = true;
+    }
+    expect(thrown, "truncated file");
+    thrown = false;
+    try {
+      MappedRBTree<int32_t, double> view(path);
+    } catch (const std::string &) {
+      thrown = true;
+    }
+    expect(thrown, "wrong key type");
+    std::filesystem::remove(path);
+  }
+
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#include "SkipList.h"
+
+/**
+ * Skiplist over int64_t keys whose nodes are sorted blocks of up to BlockSize
+ * keys. The tower links blocks by their first key, so a lookup chases a
+ * pointer per block instead of per key, and the final in-block search is a
+ * SIMD compare + movemask over one or two cache lines of keys.
+ */
+template <class Value, int BlockSize = 16,
+          class LevelGenerator = GeometricLevel<>>
+class BlockSkipList {
+  using level_t = int32_t;
+  static constexpr level_t MAXLEVEL = LevelGenerator::MAXLEVEL;
+  static constexpr int64_t EMPTY_KEY = std::numeric_limits<int64_t>::max();
+  static_assert(BlockSize >= 4 && BlockSize % 4 == 0);
+
+  struct alignas(64) BlockNode {
+    explicit BlockNode(level_t lvl) : count(0), level(lvl) {
+      std::fill_n(keys, BlockSize, EMPTY_KEY);
+      std::fill_n(next, MAXLEVEL + 1, nullptr);
+    }
+
+    inline int64_t minKey() const { return keys[0]; }
+
+    // slots past count hold EMPTY_KEY so the SIMD search can ignore count
+    int64_t keys[BlockSize];
+    Value values[BlockSize];
+    int32_t count;
+    level_t level;
+    BlockNode* next[MAXLEVEL + 1];
+  };
+
+ public:
+  explicit BlockSkipList(LevelGenerator levelGenerator = LevelGenerator())
+      : levelGenerator_(std::move(levelGenerator)),
+        globalMaxLevel_(0),
+        size_(0),
+        head_(new BlockNode(MAXLEVEL)) {}
+  ~BlockSkipList() {
+    while (head_) {
+      BlockNode* p = head_->next[0];
+      delete head_;
+      head_ = p;
+    }
+  }
+
+  BlockSkipList(const BlockSkipList&) = delete;
+  BlockSkipList& operator=(const BlockSkipList&) = delete;
+
+  /**
+   * @brief Return true if the skiplist is empty, false else
+   *
+   * @return true
+   * @return false
+   */
+  inline bool empty() const { return size_ == 0; }
+
+  inline size_t size() const { return size_; }
+
+  /**
+   * @brief Returns the corresponding Value according to the Key. If the key
+   * does not exist, returns the default Value.
+   *
+   * @param[in] key
+   * @param[in] defaultValue
+   * @return const Value&
+   */
+  const Value& find(int64_t key, const Value& defaultValue) const {
+    BlockNode* node = head_;
+    for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
+      while (node->next[curLevel] && node->next[curLevel]->minKey() <= key) {
+        node = node->next[curLevel];
+      }
+    }
+
+    int32_t pos = lowerBound(node, key);
+    if (pos < node->count && node->keys[pos] == key) {
+      return node->values[pos];
+    }
+    return defaultValue;
+  }
+
+  /**
+   * @brief If the Key exists in the skiplist, update the Value, otherwise add a
+   * new entry. A full block is split in halves.
+   *
+   * @param[in] key
+   * @param[in] value
+   */
+  void upsert(int64_t key, const Value& value) {
+    BlockNode* update[MAXLEVEL + 1];
+    BlockNode* node = head_;
+    for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
+      while (node->next[curLevel] && node->next[curLevel]->minKey() <= key) {
+        node = node->next[curLevel];
+      }
+      update[curLevel] = node;
+    }
+
+    // smaller than every key: it becomes the first key of the first block
+    if (node == head_) {
+      node = head_->next[0];
+      if (node == nullptr) {
+        node = createBlock(head_, update);
+      }
+    }
+
+    int32_t pos = lowerBound(node, key);
+    if (pos < node->count && node->keys[pos] == key) {
+      node->values[pos] = value;
+      return;
+    }
+
+    if (node->count == BlockSize) {
+      BlockNode* upper = createBlock(node, update);
+      constexpr int32_t half = BlockSize / 2;
+      std::move(node->keys + half, node->keys + BlockSize, upper->keys);
+      std::move(node->values + half, node->values + BlockSize, upper->values);
+      std::fill_n(node->keys + half, BlockSize - half, EMPTY_KEY);
+      node->count = half;
+      upper->count = BlockSize - half;
+
+      if (pos > half) {
+        node = upper;
+        pos -= half;
+      }
+    }
+
+    std::move_backward(node->keys + pos, node->keys + node->count,
+                       node->keys + node->count + 1);
+    std::move_backward(node->values + pos, node->values + node->count,
+                       node->values + node->count + 1);
+    node->keys[pos] = key;
+    node->values[pos] = value;
+    node->count++;
+    size_++;
+  }
+
+  /**
+   * @brief Delete the corresponding entry according to the Key, a block is
+   * unlinked once it runs empty
+   *
+   * @param[in] key
+   */
+  void erase(int64_t key) {
+    BlockNode* update[MAXLEVEL + 1];
+    BlockNode* node = head_;
+    for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
+      while (node->next[curLevel] && node->next[curLevel]->minKey() < key) {
+        node = node->next[curLevel];
+      }
+      update[curLevel] = node;
+    }
+
+    if (node->next[0] && node->next[0]->minKey() == key) {
+      node = node->next[0];
+    }
+
+    int32_t pos = lowerBound(node, key);
+    if (pos == node->count || node->keys[pos] != key) {
+      return;
+    }
+
+    std::move(node->keys + pos + 1, node->keys + node->count,
+              node->keys + pos);
+    std::move(node->values + pos + 1, node->values + node->count,
+              node->values + pos);
+    node->count--;
+    node->keys[node->count] = EMPTY_KEY;
+    size_--;
+
+    if (node->count == 0) {
+      // only the first key can empty a block, so update holds its preds
+      for (level_t curLevel = 0; curLevel <= node->level; curLevel++) {
+        update[curLevel]->next[curLevel] = node->next[curLevel];
+      }
+      delete node;
+    }
+  }
+
+  /* Only for debug */
+  void print() {
+    for (BlockNode* p = head_->next[0]; p; p = p->next[0]) {
+      std::cout << "[Block L" << p->level << "]: ";
+      for (int32_t i = 0; i < p->count; i++) {
+        std::cout << "{" << p->keys[i] << ", " << p->values[i] << "} ";
+      }
+      std::cout << '\n';
+    }
+  }
+
+ private:
+  /**
+   * @brief Return the number of keys in node that are smaller than key
+   *
+   * @param[in] node
+   * @param[in] key
+   * @return int32_t
+   */
+  static inline int32_t lowerBound(const BlockNode* node, int64_t key) {
+#if defined(__AVX2__)
+    const __m256i target = _mm256_set1_epi64x(key);
+    int32_t res = 0;
+    for (int32_t i = 0; i < BlockSize; i += 4) {
+      __m256i keys = _mm256_load_si256(
+          reinterpret_cast<const __m256i*>(node->keys + i));
+      __m256i less = _mm256_cmpgt_epi64(target, keys);
+      res += std::popcount(static_cast<uint32_t>(
+          _mm256_movemask_pd(_mm256_castsi256_pd(less))));
+    }
+    return res;
+#elif defined(__SSE4_2__)
+    const __m128i target = _mm_set1_epi64x(key);
+    int32_t res = 0;
+    for (int32_t i = 0; i < BlockSize; i += 2) {
+      __m128i keys =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(node->keys + i));
+      __m128i less = _mm_cmpgt_epi64(target, keys);
+      res += std::popcount(static_cast<uint32_t>(
+          _mm_movemask_pd(_mm_castsi128_pd(less))));
+    }
+    return res;
+#else
+    int32_t res = 0;
+    for (int32_t i = 0; i < BlockSize; i++) {
+      res += node->keys[i] < key;
+    }
+    return res;
+#endif
+  }
+
+  /**
+   * @brief Create an empty block and link it right after prev
+   *
+   * @param[in] prev the block to follow, on the levels it is linked on
+   * @param[in] update the predecessors on the other levels
+   * @return BlockNode*
+   */
+  BlockNode* createBlock(BlockNode* prev, BlockNode** update) {
+    const level_t level = std::min(levelGenerator_(), globalMaxLevel_ + 1);
+    BlockNode* node = new BlockNode(level);
+    for (level_t curLevel = 0; curLevel <= level; curLevel++) {
+      BlockNode* pred =
+          prev->level >= curLevel
+              ? prev
+              : (curLevel <= globalMaxLevel_ ? update[curLevel] : head_);
+      node->next[curLevel] = pred->next[curLevel];
+      pred->next[curLevel] = node;
+    }
+    globalMaxLevel_ = std::max(globalMaxLevel_, level);
+    return node;
+  }
+
+ private:
+  LevelGenerator levelGenerator_;
+  level_t globalMaxLevel_;
+  size_t size_;
+  BlockNode* head_;
+};
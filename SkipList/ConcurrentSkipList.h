@@ -0,0 +1,505 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "SkipList.h"
+
+/**
+ * Process-wide epoch based reclamation. A thread pins the current epoch with a
+ * Guard before touching shared nodes; memory retired in epoch e is only freed
+ * once the global epoch reaches e + 2, i.e. when no pinned thread can still
+ * hold a reference to it.
+ */
+class EpochManager {
+  static constexpr uint64_t QUIESCENT = UINT64_MAX;
+  static constexpr size_t MAXTHREADS = 256;
+  static constexpr size_t COLLECT_THRESHOLD = 64;
+
+  struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+  };
+
+  struct alignas(64) ThreadRecord {
+    std::atomic<uint64_t> epoch{QUIESCENT};
+    std::atomic<bool> inUse{false};
+    uint32_t depth = 0;
+    size_t retiredSinceCollect = 0;
+    std::vector<Retired> limbo;
+  };
+
+  struct RecordHolder {
+    explicit RecordHolder(EpochManager& mgr)
+        : mgr(mgr), record(mgr.acquire()) {}
+    ~RecordHolder() { mgr.release(record); }
+
+    EpochManager& mgr;
+    ThreadRecord* record;
+  };
+
+ public:
+  class Guard {
+   public:
+    Guard() : record_(EpochManager::instance().localRecord()) {
+      EpochManager::instance().enter(record_);
+    }
+    ~Guard() { EpochManager::instance().leave(record_); }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    ThreadRecord* record_;
+  };
+
+  static EpochManager& instance() {
+    static EpochManager mgr;
+    return mgr;
+  }
+
+  ~EpochManager() {
+    for (ThreadRecord& record : records_) {
+      for (Retired& r : record.limbo) {
+        r.deleter(r.ptr);
+      }
+    }
+  }
+
+  /**
+   * @brief Defer the destruction of an unlinked object until no pinned thread
+   * can observe it
+   *
+   * @param[in] ptr
+   */
+  template <class T>
+  void retire(T* ptr) {
+    if (ptr == nullptr) {
+      return;
+    }
+
+    ThreadRecord* record = localRecord();
+    record->limbo.push_back(
+        {ptr, [](void* p) { delete static_cast<T*>(p); },
+         globalEpoch_.load(std::memory_order_acquire)});
+    if (++record->retiredSinceCollect >= COLLECT_THRESHOLD) {
+      tryAdvance();
+      collect(record);
+    }
+  }
+
+ private:
+  EpochManager() = default;
+
+  ThreadRecord* localRecord() {
+    thread_local RecordHolder holder(*this);
+    return holder.record;
+  }
+
+  ThreadRecord* acquire() {
+    for (ThreadRecord& record : records_) {
+      bool expected = false;
+      if (!record.inUse.load(std::memory_order_relaxed) &&
+          record.inUse.compare_exchange_strong(expected, true)) {
+        return &record;
+      }
+    }
+    throw "Too many threads registered in EpochManager";
+  }
+
+  void release(ThreadRecord* record) {
+    tryAdvance();
+    collect(record);
+    // the remaining garbage is inherited by the next thread of this record
+    record->inUse.store(false, std::memory_order_release);
+  }
+
+  void enter(ThreadRecord* record) {
+    if (record->depth++ == 0) {
+      // a full RMW so the announcement is ordered before any later node read
+      record->epoch.exchange(globalEpoch_.load(std::memory_order_acquire));
+    }
+  }
+
+  void leave(ThreadRecord* record) {
+    if (--record->depth == 0) {
+      record->epoch.store(QUIESCENT, std::memory_order_release);
+    }
+  }
+
+  void tryAdvance() {
+    uint64_t epoch = globalEpoch_.load();
+    for (ThreadRecord& record : records_) {
+      if (!record.inUse.load(std::memory_order_acquire)) {
+        continue;
+      }
+      uint64_t local = record.epoch.load();
+      if (local != QUIESCENT && local != epoch) {
+        return;
+      }
+    }
+    globalEpoch_.compare_exchange_strong(epoch, epoch + 1);
+  }
+
+  void collect(ThreadRecord* record) {
+    record->retiredSinceCollect = 0;
+    uint64_t epoch = globalEpoch_.load(std::memory_order_acquire);
+
+    size_t kept = 0;
+    for (Retired& r : record->limbo) {
+      if (r.epoch + 2 <= epoch) {
+        r.deleter(r.ptr);
+      } else {
+        record->limbo[kept++] = r;
+      }
+    }
+    record->limbo.resize(kept);
+  }
+
+ private:
+  std::atomic<uint64_t> globalEpoch_{0};
+  ThreadRecord records_[MAXTHREADS];
+};
+
+/**
+ * Lock-free skiplist with the same find/upsert/erase surface as SkipList.
+ * Insertion links a node with CAS level by level from the bottom. Deletion
+ * first swaps the value of the victim for a null tombstone, which is the
+ * linearization point and fails any later update of the node, then marks the
+ * low bit of every next pointer of the victim (level 0 last). Any traversal
+ * helps unlinking marked nodes.
+ * Deletion never waits for a concurrent insertion: an inserter that finds its
+ * node marked stops linking it, and whichever of the two finishes last unlinks
+ * the node for good. Unlinked nodes and replaced values are reclaimed through
+ * EpochManager.
+ */
+template <class Key, class Value, class Compare = comp<Key>,
+          class LevelGenerator = GeometricLevel<>>
+class ConcurrentSkipList {
+  using level_t = int32_t;
+  static constexpr level_t MAXLEVEL = LevelGenerator::MAXLEVEL;
+  static constexpr uintptr_t MARK = 1;
+
+  // Hand-off between the inserter and the eraser of a node, see upsert/erase
+  enum LinkState : uint8_t { LINKING, LINKED, ABANDONED };
+
+  struct SkipListNode {
+    SkipListNode() : value(nullptr), level(MAXLEVEL) {}
+    explicit SkipListNode(const Key& k, Value* v, level_t lvl)
+        : key(k), value(v), level(lvl) {}
+    ~SkipListNode() { delete value.load(std::memory_order_relaxed); }
+
+    Key key;
+    // null once the node is erased
+    std::atomic<Value*> value;
+    level_t level;
+    std::atomic<uint8_t> linkState{LINKING};
+    std::atomic<uintptr_t> next[MAXLEVEL + 1] = {};
+  };
+
+ public:
+  explicit ConcurrentSkipList(LevelGenerator levelGenerator = LevelGenerator())
+      : levelGenerator_(std::move(levelGenerator)), head_(new SkipListNode) {}
+  ~ConcurrentSkipList() {
+    while (head_) {
+      SkipListNode* p = getPtr(head_->next[0].load(std::memory_order_relaxed));
+      delete head_;
+      head_ = p;
+    }
+  }
+
+  ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+  ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+  /**
+   * @brief Return true if the skiplist is empty, false else
+   *
+   * @return true
+   * @return false
+   */
+  bool empty() const {
+    EpochManager::Guard guard;
+    SkipListNode* p = getPtr(head_->next[0].load(std::memory_order_acquire));
+    while (p) {
+      uintptr_t succ = p->next[0].load(std::memory_order_acquire);
+      if (!isMarked(succ) && p->value.load(std::memory_order_acquire)) {
+        return false;
+      }
+      p = getPtr(succ);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns a copy of the corresponding Value according to the Key. If
+   * the node does not exist, returns the default Value. Never writes to shared
+   * memory, so it is wait-free.
+   *
+   * @param[in] key
+   * @param[in] defaultValue
+   * @return Value
+   */
+  Value find(const Key& key, const Value& defaultValue) const {
+    EpochManager::Guard guard;
+    SkipListNode* pred = head_;
+    SkipListNode* curr = nullptr;
+    for (level_t curLevel = MAXLEVEL; curLevel >= 0; curLevel--) {
+      curr = getPtr(pred->next[curLevel].load(std::memory_order_acquire));
+      while (curr) {
+        uintptr_t succ = curr->next[curLevel].load(std::memory_order_acquire);
+        if (isMarked(succ)) {
+          curr = getPtr(succ);
+        } else if (compareFunc_(curr->key, key) < 0) {
+          pred = curr;
+          curr = getPtr(succ);
+        } else {
+          break;
+        }
+      }
+    }
+
+    if (curr && compareFunc_(curr->key, key) == 0) {
+      if (Value* value = curr->value.load(std::memory_order_acquire); value) {
+        return *value;
+      }
+    }
+    return defaultValue;
+  }
+
+  /**
+   * @brief If the Key exists in the skiplist, update the Value, otherwise add a
+   * new entry
+   *
+   * @param[in] key
+   * @param[in] value
+   */
+  void upsert(const Key& key, const Value& value) {
+    EpochManager::Guard guard;
+    SkipListNode* preds[MAXLEVEL + 1];
+    SkipListNode* succs[MAXLEVEL + 1];
+    Value* newValue = new Value(value);
+    SkipListNode* newNode = nullptr;
+
+    while (true) {
+      if (locate(key, preds, succs, nullptr)) {
+        // The update only lands while the node is not erased, so once it has
+        // succeeded nothing is ever inserted again
+        Value* oldValue = succs[0]->value.load(std::memory_order_acquire);
+        while (oldValue) {
+          if (succs[0]->value.compare_exchange_weak(oldValue, newValue)) {
+            EpochManager::instance().retire(oldValue);
+            if (newNode) {
+              // newValue now lives in the found node
+              newNode->value.store(nullptr, std::memory_order_relaxed);
+              delete newNode;
+            }
+            return;
+          }
+        }
+        // The erase is already linearized, help it out of level 0 so that
+        // locate stops finding the node, then insert anew
+        markNext(succs[0], 0);
+        continue;
+      }
+
+      if (newNode == nullptr) {
+        newNode = new SkipListNode(key, newValue, levelGenerator_());
+      }
+      for (level_t curLevel = 0; curLevel <= newNode->level; curLevel++) {
+        newNode->next[curLevel].store(makeRef(succs[curLevel]),
+                                      std::memory_order_relaxed);
+      }
+
+      uintptr_t expected = makeRef(succs[0]);
+      if (preds[0]->next[0].compare_exchange_strong(expected,
+                                                     makeRef(newNode))) {
+        break;
+      }
+    }
+
+    // The node is visible from now on, link the rest of the tower. An eraser
+    // may mark it at any time, so its own next pointers are only updated with
+    // CAS and linking stops at the first mark found.
+    linkUpperLevels(key, newNode, preds, succs);
+
+    uint8_t state = LINKING;
+    if (!newNode->linkState.compare_exchange_strong(state, LINKED)) {
+      // erased while we were linking: the eraser left the cleanup to us
+      locate(key, preds, succs, newNode);
+      EpochManager::instance().retire(newNode);
+    }
+  }
+
+  /**
+   * @brief Delete the corresponding node according to the Key
+   *
+   * @param[in] key
+   */
+  void erase(const Key& key) {
+    EpochManager::Guard guard;
+    SkipListNode* preds[MAXLEVEL + 1];
+    SkipListNode* succs[MAXLEVEL + 1];
+    if (!locate(key, preds, succs, nullptr)) {
+      return;
+    }
+
+    SkipListNode* victim = succs[0];
+    Value* oldValue = victim->value.load(std::memory_order_acquire);
+    while (oldValue &&
+           !victim->value.compare_exchange_weak(oldValue, nullptr)) {
+    }
+    if (oldValue == nullptr) {
+      // a concurrent erase got there first
+      return;
+    }
+    EpochManager::instance().retire(oldValue);
+
+    // We own the deletion. Level 0 is marked last, though an upsert may
+    // already have helped with it
+    for (level_t curLevel = victim->level; curLevel >= 0; curLevel--) {
+      markNext(victim, curLevel);
+    }
+
+    // If the inserter is still linking, it will unlink and retire the node
+    // once it is done, otherwise make sure it is unlinked on every level
+    // before handing it to the reclaimer
+    uint8_t state = LINKING;
+    if (!victim->linkState.compare_exchange_strong(state, ABANDONED)) {
+      locate(key, preds, succs, victim);
+      EpochManager::instance().retire(victim);
+    }
+  }
+
+  /* Only for debug, not thread-safe */
+  void print() {
+    for (level_t curLevel = MAXLEVEL; curLevel >= 0; curLevel--) {
+      SkipListNode* p = getPtr(head_->next[curLevel].load());
+      if (p == nullptr) {
+        continue;
+      }
+      std::cout << "[Level " << curLevel << "]: ";
+      for (; p; p = getPtr(p->next[curLevel].load())) {
+        std::cout << "{" << p->key << ", " << *p->value.load() << "} -> ";
+      }
+      std::cout << "(x)\n";
+    }
+  }
+
+ private:
+  static inline SkipListNode* getPtr(uintptr_t ref) {
+    return reinterpret_cast<SkipListNode*>(ref & ~MARK);
+  }
+  static inline bool isMarked(uintptr_t ref) { return ref & MARK; }
+  static inline uintptr_t makeRef(SkipListNode* node) {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+
+  /**
+   * @brief Set the mark of the next pointer of node on the given level
+   *
+   * @param[in] node
+   * @param[in] level
+   */
+  static void markNext(SkipListNode* node, level_t level) {
+    uintptr_t succ = node->next[level].load(std::memory_order_acquire);
+    while (!isMarked(succ) &&
+           !node->next[level].compare_exchange_weak(succ, succ | MARK)) {
+    }
+  }
+
+  /**
+   * @brief Link newNode on levels 1..level, whose level 0 is already linked.
+   * Gives up as soon as newNode is found marked by a concurrent erase.
+   *
+   * @param[in] key
+   * @param[in] newNode
+   * @param[in,out] preds
+   * @param[in,out] succs
+   */
+  void linkUpperLevels(const Key& key, SkipListNode* newNode,
+                       SkipListNode** preds, SkipListNode** succs) {
+    for (level_t curLevel = 1; curLevel <= newNode->level; curLevel++) {
+      while (true) {
+        uintptr_t own = newNode->next[curLevel].load(std::memory_order_acquire);
+        if (isMarked(own)) {
+          return;
+        }
+        if (getPtr(own) != succs[curLevel] &&
+            !newNode->next[curLevel].compare_exchange_strong(
+                own, makeRef(succs[curLevel]))) {
+          // only an eraser writes our next pointers, so this is a mark
+          return;
+        }
+
+        uintptr_t expected = makeRef(succs[curLevel]);
+        if (preds[curLevel]->next[curLevel].compare_exchange_strong(
+                expected, makeRef(newNode))) {
+          break;
+        }
+        locate(key, preds, succs, newNode);
+      }
+    }
+  }
+
+  /**
+   * @brief Fill preds/succs with the neighbours of key on every level and
+   * unlink every marked node met on the way. If target is given, nodes with an
+   * equal key other than target are stepped over, so that target itself is
+   * guaranteed to be unlinked once this returns.
+   *
+   * @param[in] key
+   * @param[out] preds
+   * @param[out] succs
+   * @param[in] target
+   * @return true if an unmarked node with key is present on level 0
+   */
+  bool locate(const Key& key, SkipListNode** preds, SkipListNode** succs,
+              SkipListNode* target) {
+    while (true) {
+      bool restart = false;
+      SkipListNode* pred = head_;
+      for (level_t curLevel = MAXLEVEL; curLevel >= 0 && !restart;
+           curLevel--) {
+        SkipListNode* curr =
+            getPtr(pred->next[curLevel].load(std::memory_order_acquire));
+        while (curr) {
+          uintptr_t succ = curr->next[curLevel].load(std::memory_order_acquire);
+          if (isMarked(succ)) {
+            uintptr_t expected = makeRef(curr);
+            if (!pred->next[curLevel].compare_exchange_strong(
+                    expected, makeRef(getPtr(succ)))) {
+              restart = true;
+              break;
+            }
+            curr = getPtr(succ);
+            continue;
+          }
+
+          int compareResult = compareFunc_(curr->key, key);
+          if (compareResult < 0 ||
+              (compareResult == 0 && target && curr != target)) {
+            pred = curr;
+            curr = getPtr(succ);
+          } else {
+            break;
+          }
+        }
+        preds[curLevel] = pred;
+        succs[curLevel] = curr;
+      }
+
+      if (!restart) {
+        return succs[0] && compareFunc_(succs[0]->key, key) == 0;
+      }
+    }
+  }
+
+ private:
+  Compare compareFunc_;
+  // only called through operator() const, which keeps its state per thread
+  const LevelGenerator levelGenerator_;
+  SkipListNode* head_;
+};
@@ -1,8 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 template <class T>
 struct comp {
@@ -13,38 +24,358 @@ struct comp {
   }
 };
 
-template <class Key, class Value, class Compare = comp<Value>>
+/**
+ * @brief Per-thread xorshift64* generator, one word per call with no shared
+ * state between threads or skiplists
+ *
+ * @return uint64_t
+ */
+inline uint64_t threadLocalRandom() {
+  thread_local uint64_t state =
+      (static_cast<uint64_t>(std::random_device{}()) << 32 |
+       std::random_device{}()) |
+      1;
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Level policy promoting a node with probability 1 / 2^PromoteShift, capped at
+ * MaxLevel. The level is the number of trailing zero bit groups of a single
+ * random word.
+ */
+template <int PromoteShift = 2, int MaxLevel = 16>
+struct GeometricLevel {
+  static_assert(PromoteShift > 0 && PromoteShift * MaxLevel <= 64);
+  static constexpr int32_t MAXLEVEL = MaxLevel;
+
+  int32_t operator()() const {
+    int32_t level = std::countr_zero(threadLocalRandom()) / PromoteShift;
+    return std::min(level, MAXLEVEL);
+  }
+};
+
+/**
+ * Level policy promoting a node with an arbitrary runtime probability p. The
+ * word is compared against precomputed thresholds p^1, p^2, ... instead of
+ * drawing once per level.
+ */
+template <int MaxLevel = 16>
+class ProbabilityLevel {
+ public:
+  static constexpr int32_t MAXLEVEL = MaxLevel;
+
+  explicit ProbabilityLevel(double p = 0.25) {
+    if (!(p > 0 && p < 1)) {
+      throw "Promotion probability must be in (0, 1)";
+    }
+    double q = p;
+    for (int32_t level = 0; level < MAXLEVEL; level++, q *= p) {
+      thresholds_[level] = static_cast<uint64_t>(std::ldexp(q, 64));
+    }
+  }
+
+  int32_t operator()() const {
+    uint64_t word = threadLocalRandom();
+    int32_t level = 0;
+    while (level < MAXLEVEL && word < thresholds_[level]) {
+      level++;
+    }
+    return level;
+  }
+
+ private:
+  uint64_t thresholds_[MaxLevel];
+};
+
+template <class Key, class Value, class Compare = comp<Key>,
+          class LevelGenerator = GeometricLevel<>,
+          class Allocator = std::allocator<char>>
 class SkipList {
   using level_t = int32_t;
-  static constexpr level_t MAXLEVEL = 16;
+  using ByteAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+  using ByteTraits = std::allocator_traits<ByteAllocator>;
+  static constexpr level_t MAXLEVEL = LevelGenerator::MAXLEVEL;
+  static constexpr uint64_t SAMPLE_PERIOD = 64;
 
-  struct SkipListNode {
-    SkipListNode() = default;
-    explicit SkipListNode(const Key& k, const Value& v) : key(k), value(v) {}
+  /**
+   * A node only owns the (level + 1) next pointers it really uses, stored
+   * inline right after the node itself.
+   */
+  struct alignas(alignof(void*)) SkipListNode {
+    explicit SkipListNode(level_t lvl) : level(lvl) {
+      std::fill_n(tower(), lvl + 1, nullptr);
+    }
+    explicit SkipListNode(const Key& k, const Value& v, level_t lvl)
+        : key(k), value(v), level(lvl) {
+      std::fill_n(tower(), lvl + 1, nullptr);
+    }
+
+    inline SkipListNode*& next(level_t lvl) { return tower()[lvl]; }
+
+    static constexpr size_t allocSize(level_t lvl) {
+      size_t size = sizeof(SkipListNode) + (lvl + 1) * sizeof(SkipListNode*);
+      return (size + alignof(SkipListNode) - 1) & ~(alignof(SkipListNode) - 1);
+    }
 
     Key key;
     Value value;
-    SkipListNode* next[MAXLEVEL + 1] = {0};
+    level_t level;
+
+   private:
+    inline SkipListNode** tower() {
+      return reinterpret_cast<SkipListNode**>(this + 1);
+    }
+  };
+
+  /**
+   * Bump allocator carving nodes out of large blocks drawn from the
+   * skiplist's allocator. Erased nodes are kept in one free list per level and
+   * reused by later inserts of the same height.
+   */
+  class NodeArena {
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct FreeNode {
+      FreeNode* next;
+    };
+
+   public:
+    explicit NodeArena(const ByteAllocator& alloc)
+        : alloc_(alloc),
+          cur_(nullptr),
+          end_(nullptr),
+          freeList_{},
+          bytesReserved_(0),
+          bytesInUse_(0),
+          bytesFree_(0) {}
+    ~NodeArena() {
+      for (auto [block, size] : blocks_) {
+        ByteTraits::deallocate(alloc_, block, size);
+      }
+    }
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    void* allocate(level_t level) {
+      size_t size = SkipListNode::allocSize(level);
+      bytesInUse_ += size;
+      if (FreeNode* node = freeList_[level]; node) {
+        freeList_[level] = node->next;
+        bytesFree_ -= size;
+        return node;
+      }
+
+      if (cur_ == nullptr || static_cast<size_t>(end_ - cur_) < size) {
+        size_t blockSize = std::max(BLOCK_SIZE, size);
+        cur_ = ByteTraits::allocate(alloc_, blockSize);
+        end_ = cur_ + blockSize;
+        blocks_.emplace_back(cur_, blockSize);
+        bytesReserved_ += blockSize;
+      }
+
+      void* res = cur_;
+      cur_ += size;
+      return res;
+    }
+
+    void deallocate(void* ptr, level_t level) {
+      size_t size = SkipListNode::allocSize(level);
+      bytesInUse_ -= size;
+      bytesFree_ += size;
+
+      FreeNode* node = static_cast<FreeNode*>(ptr);
+      node->next = freeList_[level];
+      freeList_[level] = node;
+    }
+
+    inline size_t blocks() const { return blocks_.size(); }
+    inline size_t bytesReserved() const { return bytesReserved_; }
+    inline size_t bytesInUse() const { return bytesInUse_; }
+    inline size_t bytesFree() const { return bytesFree_; }
+
+   private:
+    ByteAllocator alloc_;
+    char* cur_;
+    char* end_;
+    FreeNode* freeList_[MAXLEVEL + 1];
+    std::vector<std::pair<char*, size_t>> blocks_;
+
+    size_t bytesReserved_;
+    size_t bytesInUse_;
+    size_t bytesFree_;
+  };
+
+  /**
+   * Forward iterator in key order, end() is a null node. Dereferencing yields
+   * a (key, value) pair of references, so the key cannot be changed in place.
+   */
+  template <bool Const>
+  class SkipListIterator {
+    friend class SkipList;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<const Key, Value>;
+    using difference_type = std::ptrdiff_t;
+    using reference =
+        std::pair<const Key&, std::conditional_t<Const, const Value&, Value&>>;
+    struct pointer {
+      reference ref;
+      reference* operator->() { return &ref; }
+    };
+
+    SkipListIterator() : object_(nullptr) {}
+    // a mutable iterator converts to a const one
+    template <bool OtherConst, class = std::enable_if_t<Const && !OtherConst>>
+    SkipListIterator(const SkipListIterator<OtherConst>& other)
+        : object_(other.object_) {}
+
+    bool operator==(const SkipListIterator& other) const {
+      return object_ == other.object_;
+    }
+
+    pointer operator->() const { return pointer{**this}; }
+    reference operator*() const { return {object_->key, object_->value}; }
+
+    SkipListIterator& operator++() {
+      object_ = object_->next(0);
+      return *this;
+    }
+    SkipListIterator operator++(int) {
+      SkipListIterator tmp = *this;
+      object_ = object_->next(0);
+      return tmp;
+    }
+
+   private:
+    explicit SkipListIterator(SkipListNode* ptr) : object_(ptr) {}
+
+   private:
+    SkipListNode* object_;
+  };
+
+ public:
+  using iterator = SkipListIterator<false>;
+  using const_iterator = SkipListIterator<true>;
+
+  struct Stats {
+    size_t size;
+    level_t maxLevel;
+    // levelNodes[l] is the number of nodes linked on level l
+    std::array<size_t, MAXLEVEL + 1> levelNodes;
+    // bytes held by live nodes, head included
+    size_t bytesUsed;
+    // bytes of all arena blocks, and the part of it parked in free lists
+    size_t bytesReserved;
+    size_t bytesFree;
+    size_t arenaBlocks;
+    // next pointers followed per lookup, over one in SAMPLE_PERIOD finds
+    double avgSearchPath;
+    uint64_t sampledSearches;
   };
 
  public:
-  SkipList() : globalMaxLevel_(0), head_(new SkipListNode) {}
+  explicit SkipList(LevelGenerator levelGenerator = LevelGenerator(),
+                    const Allocator& alloc = Allocator())
+      : levelGenerator_(std::move(levelGenerator)),
+        arena_(alloc),
+        globalMaxLevel_(0),
+        head_(createNode(MAXLEVEL)),
+        fingerValid_(false),
+        size_(0),
+        heightCount_{},
+        sampledSearches_(0),
+        sampledSteps_(0) {}
   ~SkipList() {
-    SkipListNode* p = head_->next[0];
-    while (head_) {
-      delete head_;
-      head_ = p;
-      if (p) p = p->next[0];
+    // The arena releases all blocks at once, only non-trivial members still
+    // need their destructors run
+    if constexpr (!std::is_trivially_destructible_v<Key> ||
+                  !std::is_trivially_destructible_v<Value>) {
+      SkipListNode* p = head_;
+      while (p) {
+        SkipListNode* next = p->next(0);
+        p->~SkipListNode();
+        p = next;
+      }
     }
   }
 
+  SkipList(const SkipList&) = delete;
+  SkipList& operator=(const SkipList&) = delete;
+
   /**
    * @brief Return true if the skiplist is empty, false else
    *
    * @return true
    * @return false
    */
-  inline bool empty() const { return head_->next[0] != nullptr; }
+  inline bool empty() const { return head_->next(0) == nullptr; }
+
+  inline size_t size() const { return size_; }
+
+  iterator begin() { return iterator(head_->next(0)); }
+  iterator end() { return iterator(); }
+  const_iterator begin() const { return const_iterator(head_->next(0)); }
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  /**
+   * @brief Return an iterator to the first node whose key is not less than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator lower_bound(const Key& key) {
+    return iterator(seekInternal<false>(key));
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return const_iterator(seekInternal<false>(key));
+  }
+
+  /**
+   * @brief Return an iterator to the first node whose key is greater than key
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator upper_bound(const Key& key) {
+    return iterator(seekInternal<true>(key));
+  }
+  const_iterator upper_bound(const Key& key) const {
+    return const_iterator(seekInternal<true>(key));
+  }
+
+  /**
+   * @brief Position an iterator at key, or at the next larger key if absent
+   *
+   * @param[in] key
+   * @return iterator
+   */
+  iterator seek(const Key& key) { return lower_bound(key); }
+  const_iterator seek(const Key& key) const { return lower_bound(key); }
+
+  /**
+   * @brief Call callback(key, value) on every entry with from <= key < to in
+   * ascending order. Only descends the tower once, then walks level 0.
+   *
+   * @param[in] from
+   * @param[in] to
+   * @param[in] callback
+   */
+  template <class Callback>
+  void scan(const Key& from, const Key& to, Callback&& callback) const {
+    for (SkipListNode* p = seekInternal<false>(from);
+         p && compareFunc_(p->key, to) < 0; p = p->next(0)) {
+      callback(static_cast<const Key&>(p->key),
+               static_cast<const Value&>(p->value));
+    }
+  }
 
   /**
    * @brief Returns the corresponding Value according to the Key. If the node
@@ -56,18 +387,22 @@ class SkipList {
    */
   const Value& find(const Key& key, const Value& defaultValue) const {
     SkipListNode* node = head_;
-    for (level_t curLevel = MAXLEVEL; curLevel >= 0; curLevel--) {
-      while (node->next[curLevel] &&
-             compareFunc_(node->next[curLevel]->key, key) < 0) {
-        node = node->next[curLevel];
+    uint64_t steps = 0;
+    for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
+      while (node->next(curLevel) &&
+             compareFunc_(node->next(curLevel)->key, key) < 0) {
+        node = node->next(curLevel);
+        steps++;
       }
 
-      if (node->next[curLevel] &&
-          compareFunc_(node->next[curLevel]->key, key) == 0) {
-        return node->next[0]->value;
+      if (node->next(curLevel) &&
+          compareFunc_(node->next(curLevel)->key, key) == 0) {
+        sampleSearch(steps);
+        return node->next(curLevel)->value;
       }
     }
 
+    sampleSearch(steps);
     return defaultValue;
   }
 
@@ -79,38 +414,68 @@ class SkipList {
    * @param[in] value
    */
   void upsert(const Key& key, const Value& value) {
-    SkipListNode* node = head_;
-    const level_t localMaxLevel = randomLevel(globalMaxLevel_);
-
-    SkipListNode* newNode = nullptr;
-    for (level_t curLevel = localMaxLevel; curLevel >= 0; curLevel--) {
-      while (node->next[curLevel] &&
-             compareFunc_(node->next[curLevel]->key, key) < 0) {
-        node = node->next[curLevel];
-      }
+    SkipListNode* update[MAXLEVEL + 1];
+    SkipListNode* node = descend(key, head_, globalMaxLevel_, update);
+    if (node) {
+      node->value = value;
+      return;
+    }
+    link(key, value, update);
+    fingerValid_ = false;
+  }
 
-      if (node->next[curLevel] &&
-          compareFunc_(node->next[curLevel]->key, key) == 0) {
-        std::swap(node->next[curLevel]->value, const_cast<Value&>(value));
-        return;
-      }
+  /**
+   * @brief Same as upsert, but starts searching from the predecessors of the
+   * previous upsertSorted call. Ascending (or nearly ascending) keys then cost
+   * amortized O(1) each instead of a full descent from head.
+   *
+   * @param[in] key
+   * @param[in] value
+   */
+  void upsertSorted(const Key& key, const Value& value) {
+    if (!fingerValid_ ||
+        (finger_[0] != head_ && compareFunc_(finger_[0]->key, key) >= 0)) {
+      std::fill_n(finger_, MAXLEVEL + 1, head_);
+    }
 
-      if (newNode == nullptr) {
-        newNode = new SkipListNode(key, value);
-      }
+    // finger_[l] precedes key on level l as soon as its successor is not
+    // smaller than key, and then so do all fingers above it
+    level_t fromLevel = 0;
+    while (fromLevel < globalMaxLevel_ && finger_[fromLevel]->next(fromLevel) &&
+           compareFunc_(finger_[fromLevel]->next(fromLevel)->key, key) < 0) {
+      fromLevel++;
+    }
 
-      newNode->next[curLevel] = node->next[curLevel];
-      node->next[curLevel] = newNode;
+    SkipListNode* update[MAXLEVEL + 1];
+    std::copy(finger_ + fromLevel + 1, finger_ + MAXLEVEL + 1,
+              update + fromLevel + 1);
+    SkipListNode* node = descend(key, finger_[fromLevel], fromLevel, update);
+    if (node) {
+      node->value = value;
+      return;
     }
 
-    if (localMaxLevel > globalMaxLevel_) {
-      globalMaxLevel_ = localMaxLevel;
+    link(key, value, update);
+    std::copy(update, update + globalMaxLevel_ + 1, finger_);
+    fingerValid_ = true;
+  }
+
+  /**
+   * @brief Upsert every {key, value} pair in [begin, end), which is expected to
+   * be sorted by key
+   *
+   * @param[in] begin
+   * @param[in] end
+   */
+  template <class InputIt>
+  void bulkLoad(InputIt begin, InputIt end) {
+    for (; begin != end; ++begin) {
+      upsertSorted(begin->first, begin->second);
     }
   }
 
   /**
-   * @brief Reduce the cnt of the corresponding node according to the Key, and
-   * delete it if it reaches zero
+   * @brief Delete the corresponding node according to the Key
    *
    * @param[in] key
    */
@@ -118,28 +483,62 @@ class SkipList {
     SkipListNode* node = head_;
     SkipListNode* deleteNode = nullptr;
 
-    for (level_t curLevel = MAXLEVEL; curLevel >= 0; curLevel--) {
-      while (node->next[curLevel] &&
-             compareFunc_(node->next[curLevel]->key, key) < 0) {
-        node = node->next[curLevel];
+    for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
+      while (node->next(curLevel) &&
+             compareFunc_(node->next(curLevel)->key, key) < 0) {
+        node = node->next(curLevel);
       }
 
-      if (node->next[curLevel] &&
-          compareFunc_(node->next[curLevel]->key, key) == 0) {
-        deleteNode = node->next[curLevel];
-        node->next[curLevel] = deleteNode->next[curLevel];
+      if (node->next(curLevel) &&
+          compareFunc_(node->next(curLevel)->key, key) == 0) {
+        deleteNode = node->next(curLevel);
+        node->next(curLevel) = deleteNode->next(curLevel);
       }
     }
 
     if (deleteNode) {
-      delete deleteNode;
+      --size_;
+      --heightCount_[deleteNode->level];
+      destroyNode(deleteNode);
+      fingerValid_ = false;
+    }
+  }
+
+  /**
+   * @brief Return the shape and memory usage of the skiplist. Everything but
+   * the sampled search path is maintained incrementally, so this only costs
+   * O(MAXLEVEL).
+   *
+   * @return Stats
+   */
+  Stats stats() const {
+    Stats res{};
+    res.size = size_;
+    res.maxLevel = globalMaxLevel_;
+
+    size_t reaching = 0;
+    for (level_t level = MAXLEVEL; level >= 0; level--) {
+      reaching += heightCount_[level];
+      res.levelNodes[level] = reaching;
     }
+
+    res.bytesUsed = arena_.bytesInUse();
+    res.bytesReserved = arena_.bytesReserved();
+    res.bytesFree = arena_.bytesFree();
+    res.arenaBlocks = arena_.blocks();
+    res.sampledSearches = sampledSearches_.load(std::memory_order_relaxed);
+    res.avgSearchPath =
+        res.sampledSearches
+            ? double(sampledSteps_.load(std::memory_order_relaxed)) /
+                  res.sampledSearches
+            : 0;
+    return res;
   }
 
   void print() {
     for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
       std::cout << "[Level " << curLevel << "]: ";
-      for (SkipListNode* p = head_; p->next[curLevel]; p = p->next[curLevel]) {
+      for (SkipListNode* p = head_->next(curLevel); p; p = p->next(curLevel)) {
         std::cout << "{" << p->key << ", " << p->value << "} -> ";
       }
       std::cout << "(x)\n";
@@ -147,26 +546,134 @@ class SkipList {
   }
 
  private:
+  SkipListNode* createNode(level_t level) {
+    return new (arena_.allocate(level)) SkipListNode(level);
+  }
+
+  SkipListNode* createNode(const Key& key, const Value& value, level_t level) {
+    return new (arena_.allocate(level)) SkipListNode(key, value, level);
+  }
+
   /**
-   * @brief Randomly generate a level
+   * @brief Walk down from node on fromLevel, recording the last node before key
+   * of every level in update
    *
-   * @return level_t
+   * @param[in] key
+   * @param[in] node
+   * @param[in] fromLevel
+   * @param[out] update
+   * @return SkipListNode* the node holding key, nullptr if absent
    */
-  static inline level_t randomLevel(level_t maxLevel) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 10);
+  SkipListNode* descend(const Key& key, SkipListNode* node, level_t fromLevel,
+                        SkipListNode** update) const {
+    for (level_t curLevel = fromLevel; curLevel >= 0; curLevel--) {
+      while (node->next(curLevel) &&
+             compareFunc_(node->next(curLevel)->key, key) < 0) {
+        node = node->next(curLevel);
+      }
 
-    level_t level = 0;
-    // Increase level with 30% probability
-    while (level <= maxLevel && dis(gen) <= 2) {
-      level++;
+      if (node->next(curLevel) &&
+          compareFunc_(node->next(curLevel)->key, key) == 0) {
+        return node->next(curLevel);
+      }
+      update[curLevel] = node;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Link a new node right after the predecessors in update
+   *
+   * @param[in] key
+   * @param[in] value
+   * @param[in] update
+   */
+  void link(const Key& key, const Value& value, SkipListNode** update) {
+    const level_t localMaxLevel = randomLevel();
+    for (level_t curLevel = globalMaxLevel_ + 1; curLevel <= localMaxLevel;
+         curLevel++) {
+      update[curLevel] = head_;
+    }
+
+    SkipListNode* newNode = createNode(key, value, localMaxLevel);
+    ++size_;
+    ++heightCount_[localMaxLevel];
+    for (level_t curLevel = 0; curLevel <= localMaxLevel; curLevel++) {
+      newNode->next(curLevel) = update[curLevel]->next(curLevel);
+      update[curLevel]->next(curLevel) = newNode;
+    }
+
+    if (localMaxLevel > globalMaxLevel_) {
+      globalMaxLevel_ = localMaxLevel;
+    }
+  }
+
+  /**
+   * @brief Return the first node whose key is greater than key if Strict,
+   * greater or equal otherwise
+   *
+   * @param[in] key
+   * @return SkipListNode*
+   */
+  template <bool Strict>
+  SkipListNode* seekInternal(const Key& key) const {
+    SkipListNode* node = head_;
+    for (level_t curLevel = globalMaxLevel_; curLevel >= 0; curLevel--) {
+      while (node->next(curLevel)) {
+        int compareResult = compareFunc_(node->next(curLevel)->key, key);
+        if (compareResult > 0 || (!Strict && compareResult == 0)) {
+          break;
+        }
+        node = node->next(curLevel);
+      }
+    }
+    return node->next(0);
+  }
+
+  void destroyNode(SkipListNode* node) {
+    level_t level = node->level;
+    node->~SkipListNode();
+    arena_.deallocate(node, level);
+  }
+
+  /**
+   * @brief Record one in SAMPLE_PERIOD lookups of the calling thread. The
+   * tick is thread local and the totals atomic, so concurrent const finds on
+   * a shared list stay race free and unsampled ones write nothing shared.
+   *
+   * @param[in] steps
+   */
+  inline void sampleSearch(uint64_t steps) const {
+    thread_local uint64_t lookupTick = 0;
+    if ((++lookupTick & (SAMPLE_PERIOD - 1)) == 0) {
+      sampledSearches_.fetch_add(1, std::memory_order_relaxed);
+      sampledSteps_.fetch_add(steps, std::memory_order_relaxed);
     }
-    return level;
+  }
+
+  /**
+   * @brief Randomly generate a level, at most one above the current top
+   *
+   * @return level_t
+   */
+  inline level_t randomLevel() const {
+    return std::min(levelGenerator_(), globalMaxLevel_ + 1);
   }
 
  private:
   Compare compareFunc_;
+  LevelGenerator levelGenerator_;
+  NodeArena arena_;
   level_t globalMaxLevel_;
   SkipListNode* head_;
-};
\ No newline at end of file
+
+  // predecessors of the last upsertSorted key, dropped by any other mutation
+  bool fingerValid_;
+  SkipListNode* finger_[MAXLEVEL + 1];
+
+  size_t size_;
+  // heightCount_[l] is the number of nodes whose tower tops out at level l
+  size_t heightCount_[MAXLEVEL + 1];
+  mutable std::atomic<uint64_t> sampledSearches_;
+  mutable std::atomic<uint64_t> sampledSteps_;
+};
@@ -0,0 +1,98 @@
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BlockSkipList.h"
+#include "ConcurrentSkipList.h"
+#include "SkipList.h"
+
+template <class List>
+double benchLookup(List& list, const std::vector<int64_t>& probes,
+                   int64_t& checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t key : probes) {
+    checksum += list.find(key, -1);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         probes.size();
+}
+
+/**
+ * @brief Let the given number of threads upsert disjoint random keys into one
+ * ConcurrentSkipList at the same time. The total number of keys is fixed, so
+ * every run ends with a list of the same size.
+ *
+ * @param[in] threads
+ * @param[in] total
+ * @return double million upserts per second over all threads
+ */
+double benchConcurrentUpsert(int threads, size_t total) {
+  size_t perThread = total / threads;
+  ConcurrentSkipList<int64_t, int64_t> list;
+  std::vector<std::vector<int64_t>> keys(threads);
+  std::mt19937_64 gen(threads);
+  for (auto& threadKeys : keys) {
+    threadKeys.resize(perThread);
+    for (int64_t& key : threadKeys) {
+      key = gen() >> 1;
+    }
+  }
+
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&list, &go, &threadKeys = keys[t]]() {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (int64_t key : threadKeys) {
+        list.upsert(key, key & 0xff);
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return threads * perThread /
+         std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+int main() {
+  std::mt19937_64 gen(42);
+  for (size_t n : {100000, 1000000, 4000000}) {
+    std::vector<int64_t> keys(n);
+    for (int64_t& key : keys) {
+      key = gen() >> 1;
+    }
+    std::vector<int64_t> probes(1000000);
+    for (int64_t& probe : probes) {
+      probe = keys[gen() % n];
+    }
+
+    SkipList<int64_t, int64_t> list;
+    BlockSkipList<int64_t, 16> blocks;
+    for (int64_t key : keys) {
+      list.upsert(key, key & 0xff);
+      blocks.upsert(key, key & 0xff);
+    }
+
+    int64_t listSum = 0, blockSum = 0;
+    double listNs = benchLookup(list, probes, listSum);
+    double blockNs = benchLookup(blocks, probes, blockSum);
+    std::cout << "n = " << n << ": SkipList " << listNs
+              << " ns/find, BlockSkipList " << blockNs << " ns/find"
+              << (listSum == blockSum ? "" : " (MISMATCH)") << '\n';
+  }
+
+  for (int threads : {1, 2, 4, 8, 16, 32}) {
+    std::cout << "threads = " << threads << ": ConcurrentSkipList "
+              << benchConcurrentUpsert(threads, 1 << 20) << " M upserts/s\n";
+  }
+  return 0;
+}
@@ -1,3 +1,15 @@
+#include <cassert>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../Buddy/SlabAllocator.h"
+#include "BlockSkipList.h"
+#include "ConcurrentSkipList.h"
 #include "SkipList.h"
 
 int main() {
@@ -14,5 +26,253 @@ int main() {
     list.erase(i * 2);
   }
   list.print();
+
+  std::cout << "\n## ITERATOR ##\n";
+  {
+    for (auto iter = list.seek(40); iter != list.upper_bound(50); ++iter) {
+      std::cout << iter->first << ' ';
+    }
+    std::cout << '\n';
+
+    assert(list.lower_bound(40)->first == 41);
+    assert(list.upper_bound(41)->first == 43);
+    assert(list.lower_bound(100) == list.end());
+
+    int count = 0;
+    list.scan(10, 20, [&count](const int& key, const int& value) {
+      assert(key >= 10 && key < 20 && key % 2);
+      count++;
+    });
+    assert(count == 5);
+
+    count = 0;
+    for (auto iter = list.begin(); iter != list.end(); iter++) {
+      count++;
+    }
+    assert(count == 50);
+
+    // values are writable through an iterator, keys only readable
+    using Traits = std::iterator_traits<SkipList<int, int>::const_iterator>;
+    static_assert(std::is_same_v<Traits::iterator_category,
+                                 std::forward_iterator_tag>);
+    static_assert(!std::is_assignable_v<decltype(list.begin()->first), int>);
+    list.lower_bound(41)->second = -41;
+    assert(list.find(41, 0) == -41);
+    const auto& constList = list;
+    SkipList<int, int>::const_iterator constIter = list.seek(41);
+    assert(constIter == constList.lower_bound(41));
+    assert((*constIter).second == -41);
+    static_assert(!std::is_assignable_v<decltype(constIter->second), int>);
+    (*list.seek(41)).second = 41;
+    assert(std::distance(constList.cbegin(), constList.cend()) == 50);
+  }
+
+  std::cout << "\n## BULK LOAD ##\n";
+  {
+    std::vector<std::pair<int, int>> sorted;
+    for (int i = 0; i < 100000; i++) {
+      sorted.emplace_back(i * 3, i);
+    }
+    SkipList<int, int> bulk;
+    bulk.bulkLoad(sorted.begin(), sorted.end());
+    // out of order and interleaved mutations fall back to a full descent
+    bulk.upsertSorted(1, -1);
+    bulk.erase(3);
+    bulk.upsertSorted(4, -4);
+    bulk.upsertSorted(6, -6);
+    bulk.upsert(7, -7);
+    bulk.upsertSorted(8, -8);
+
+    assert(bulk.find(1, 0) == -1 && bulk.find(3, 0) == 0);
+    assert(bulk.find(4, 0) == -4 && bulk.find(6, 0) == -6);
+    assert(bulk.find(7, 0) == -7 && bulk.find(8, 0) == -8);
+    int prev = -1, count = 0;
+    for (auto iter = bulk.begin(); iter != bulk.end(); ++iter, ++count) {
+      assert(iter->first > prev);
+      prev = iter->first;
+    }
+    assert(count == 100000 + 3);
+    for (int i = 3; i < 100000; i++) {
+      assert(bulk.find(i * 3, -1) == i);
+    }
+    std::cout << "bulk load passed\n";
+  }
+
+  std::cout << "\n## LEVEL POLICY ##\n";
+  {
+    SkipList<int, int, comp<int>, ProbabilityLevel<8>> tuned(
+        ProbabilityLevel<8>(0.5));
+    SkipList<int, int, comp<int>, GeometricLevel<1, 20>> tall;
+    for (int i = 0; i < 10000; i++) {
+      tuned.upsert(i, i);
+      tall.upsert(i, i);
+    }
+    for (int i = 0; i < 10000; i++) {
+      assert(tuned.find(i, -1) == i && tall.find(i, -1) == i);
+    }
+    std::cout << "custom level policies passed\n";
+  }
+
+  std::cout << "\n## STATS ##\n";
+  {
+    for (int i = 0; i < 1000; i++) {
+      list.find(i, -1);
+    }
+    auto stats = list.stats();
+    assert(stats.size == 50 && stats.levelNodes[0] == 50);
+    std::cout << "size " << stats.size << ", max level " << stats.maxLevel
+              << ", bytes used/free/reserved " << stats.bytesUsed << '/'
+              << stats.bytesFree << '/' << stats.bytesReserved
+              << ", avg search path " << stats.avgSearchPath << '\n';
+    for (int level = 0; level <= stats.maxLevel; level++) {
+      std::cout << "[Level " << level << "]: " << stats.levelNodes[level]
+                << " nodes\n";
+    }
+    // const finds from several threads share no unsynchronized state
+    const auto& shared = list;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+      readers.emplace_back([&shared]() {
+        for (int i = 0; i < 6400; i++) {
+          int key = i % 100;
+          assert(shared.find(key, -1) == (key % 2 ? key : -1));
+        }
+      });
+    }
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    assert(list.stats().sampledSearches == stats.sampledSearches + 400);
+  }
+
+  std::cout << "\n## BLOCK ##\n";
+  {
+    BlockSkipList<int64_t, 8> blocks;
+    std::map<int64_t, int64_t> expected;
+    std::mt19937_64 gen(42);
+    for (int i = 0; i < 20000; i++) {
+      int64_t key = gen() % 5000 - 2500;
+      if (gen() % 3 == 0) {
+        blocks.erase(key);
+        expected.erase(key);
+      } else {
+        blocks.upsert(key, i);
+        expected[key] = i;
+      }
+    }
+    assert(blocks.size() == expected.size());
+    for (int64_t key = -2600; key < 2600; key++) {
+      auto iter = expected.find(key);
+      assert(blocks.find(key, -1) ==
+             (iter == expected.end() ? -1 : iter->second));
+    }
+    std::cout << "block skiplist matches std::map\n";
+  }
+
+  std::cout << "\n## ARENA ##\n";
+  {
+    SkipList<std::string, std::string> strList;
+    for (int round = 0; round < 3; round++) {
+      for (int i = 0; i < 1000; i++) {
+        strList.upsert(std::to_string(i), std::string(32, 'a' + round));
+      }
+      for (int i = 0; i < 1000; i += 2) {
+        strList.erase(std::to_string(i));
+      }
+    }
+    assert(strList.find("1", "") == std::string(32, 'c'));
+    assert(strList.find("2", "").empty());
+    std::cout << "node reuse with non-trivial members passed\n";
+
+    using Slab = SlabAllocator<1 << 20>;
+    using Alloc = SlabNodeAllocator<char, Slab>;
+    Slab slab;
+    SkipList<int, int, comp<int>, GeometricLevel<>, Alloc> slabList{
+        GeometricLevel<>(), Alloc(slab)};
+    for (int i = 0; i < 5000; i++) {
+      slabList.upsert(i, i * 2);
+    }
+    assert(slabList.find(4999, -1) == 9998 && slabList.size() == 5000);
+    std::cout << "arena blocks from a slab allocator passed\n";
+  }
+
+  std::cout << "\n## CONCURRENT ##\n";
+  {
+    constexpr int THREADS = 8;
+    constexpr int PER_THREAD = 2000;
+    ConcurrentSkipList<int, int> clist;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++) {
+      workers.emplace_back([&clist, t]() {
+        for (int i = t; i < THREADS * PER_THREAD; i += THREADS) {
+          clist.upsert(i, i);
+        }
+        for (int i = t; i < THREADS * PER_THREAD; i += THREADS) {
+          if (i % 2) clist.erase(i);
+        }
+        for (int i = t; i < THREADS * PER_THREAD; i += THREADS) {
+          clist.upsert(i, -i);
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    for (int i = 0; i < THREADS * PER_THREAD; i++) {
+      assert(clist.find(i, 1) == -i);
+    }
+    for (int i = 0; i < THREADS * PER_THREAD; i++) {
+      clist.erase(i);
+    }
+    assert(clist.empty());
+    std::cout << "concurrent upsert/erase/find passed\n";
+  }
+
+  {
+    // Every thread races upsert/erase/find on the same few keys, so inserters
+    // get their nodes marked mid-link and traversals help unlinking
+    constexpr int THREADS = 8;
+    constexpr int KEYS = 16;
+    constexpr int ROUNDS = 20000;
+    ConcurrentSkipList<int, int> clist;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++) {
+      workers.emplace_back([&clist, t]() {
+        std::mt19937 gen(t);
+        for (int i = 0; i < ROUNDS; i++) {
+          int key = gen() % KEYS;
+          switch (gen() % 3) {
+            case 0:
+              clist.upsert(key, key * ROUNDS * THREADS + i * THREADS + t);
+              break;
+            case 1:
+              clist.erase(key);
+              break;
+            default:
+              int value = clist.find(key, -1);
+              assert(value == -1 || value / (ROUNDS * THREADS) == key);
+          }
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    // Once quiet, the list must behave like a sequential map again
+    for (int key = 0; key < KEYS; key++) {
+      clist.upsert(key, key);
+    }
+    for (int key = 0; key < KEYS; key++) {
+      assert(clist.find(key, -1) == key);
+      clist.erase(key);
+      assert(clist.find(key, -1) == -1);
+    }
+    assert(clist.empty());
+    std::cout << "concurrent races on shared keys passed\n";
+  }
   return 0;
-}
\ No newline at end of file
+}
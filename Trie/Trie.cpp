@@ -11,7 +11,8 @@ static size_t longestPrefixMatchLength(const char* a, const char* b) {
   return res;
 }
 
-PrefixTrie::PrefixTrie() : root(new TrieNode) {}
+PrefixTrie::PrefixTrie(std::pmr::memory_resource* resource)
+    : resource_(resource), root(createNode()) {}
 
 PrefixTrie::~PrefixTrie() { destory(root); }
 
@@ -43,7 +44,7 @@ bool PrefixTrie::remove(const std::string& str) {
 
 void PrefixTrie::insertInternal(TrieNode*& node, const std::string_view& str) {
   if (node == nullptr) {
-    node = new TrieNode(str);
+    node = createNode(str);
     node->isEndOfString_ = true;
     return;
   }
@@ -53,7 +54,7 @@ void PrefixTrie::insertInternal(TrieNode*& node, const std::string_view& str) {
     TrieNode* cur = node;
     cur->data_.erase(0, matchLength);
 
-    node = new TrieNode(str.substr(0, matchLength));
+    node = createNode(str.substr(0, matchLength));
     node->children_[getIndex(cur->data_.at(0))] = cur;
     node->numOfChilren_ = 1;
   }
@@ -104,7 +105,7 @@ bool PrefixTrie::removeInternal(TrieNode*& node, const std::string_view& str) {
     }
     node->isEndOfString_ = false;
     if (node->isLeaf()) {
-      delete node;
+      destroyNode(node);
       node = nullptr;
     }
     return true;
@@ -117,7 +118,7 @@ bool PrefixTrie::removeInternal(TrieNode*& node, const std::string_view& str) {
 
   node->numOfChilren_--;
   if (node->isLeaf() && !node->isEndOfString_) {
-    delete node;
+    destroyNode(node);
     node = nullptr;
   }
   return true;
@@ -132,7 +133,17 @@ void PrefixTrie::destory(TrieNode* node) {
     }
   }
 
-  delete node;
+  destroyNode(node);
+}
+
+PrefixTrie::TrieNode* PrefixTrie::createNode(const std::string_view& str) {
+  void* ptr = resource_->allocate(sizeof(TrieNode), alignof(TrieNode));
+  return new (ptr) TrieNode(str);
+}
+
+void PrefixTrie::destroyNode(TrieNode* node) {
+  node->~TrieNode();
+  resource_->deallocate(node, sizeof(TrieNode), alignof(TrieNode));
 }
 
 std::vector<std::string> PrefixTrie::toVector() {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -29,9 +30,18 @@ class PrefixTrie {
   };
 
  public:
-  PrefixTrie();
+  /**
+   * @brief Build an empty Trie whose nodes are allocated from resource
+   *
+   * @param[in] resource
+   */
+  explicit PrefixTrie(
+      std::pmr::memory_resource* resource = std::pmr::new_delete_resource());
   ~PrefixTrie();
 
+  PrefixTrie(const PrefixTrie&) = delete;
+  PrefixTrie& operator=(const PrefixTrie&) = delete;
+
   /**
    * @brief Return true if the Trie is empty, false else
    *
@@ -138,6 +148,22 @@ class PrefixTrie {
    */
   void destory(TrieNode* node);
 
+  /**
+   * @brief Allocate a node from the memory resource
+   *
+   * @param[in] str
+   * @return TrieNode*
+   */
+  TrieNode* createNode(const std::string_view& str = {});
+
+  /**
+   * @brief Destroy a node and give its memory back to the memory resource
+   *
+   * @param[in] node
+   */
+  void destroyNode(TrieNode* node);
+
  private:
+  std::pmr::memory_resource* resource_;
   TrieNode* root;
 };
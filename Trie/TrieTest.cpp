@@ -1,9 +1,19 @@
 #include <assert.h>
 
+#include <cstdlib>
 #include <iostream>
 
+#include "../Buddy/SlabAllocator.h"
 #include "Trie.h"
 
+// TrieTest builds in Release, so checks must not compile away like assert
+static void expect(bool cond, const char* what) {
+  if (!cond) {
+    std::cerr << "check failed: " << what << std::endl;
+    exit(-1);
+  }
+}
+
 void printTree(PrefixTrie& tree) {
   auto&& vec = tree.toVector();
   if (vec.empty()) {
@@ -39,6 +49,24 @@ int main() {
 
   assert(tree.empty());
 
+  std::cout << "==SLAB==\n";
+  {
+    SlabAllocator<1 << 20> slab;
+    BuddyMemoryResource resource(slab);
+    PrefixTrie slabTree(&resource);
+    slabTree.insert("abc");
+    slabTree.insert("abd");
+    slabTree.insert("b");
+    expect(slabTree.exist("abc") && slabTree.exist("abd") &&
+               slabTree.exist("b"),
+           "slab trie finds inserted words");
+    expect(!slabTree.exist("ab") && !slabTree.exist("abcd"),
+           "slab trie misses prefixes and extensions");
+    expect(slabTree.toVector().size() == 3, "slab trie word count");
+    printTree(slabTree);
+    slab.print();
+  }
+
   std::cout << "\n\ntest success" << std::endl;
   return 0;
 }
\ No newline at end of file